@@ -0,0 +1,145 @@
+/*		This file contains the signal processing for audio
+			reactive mode. Each 1 ms frame of samples is split into
+			AUDIO_BANDS frequency bands by a bank of band-pass
+			filters. A band's LED lights when its level jumps
+			above its own slowly adapting average, so the LEDs
+			follow the beat at any volume. Like sequence.c it
+			touches no hardware, so the same code runs on the board
+			(mic.c) and on a PC (sim/wav_sim.c).
+
+			The filters are biquads in q15 with q14 coefficients.
+			The band-pass numerator has no x[n-1] term, so each
+			sample takes two dual 16-bit multiply-accumulates
+			(SMUAD, SMLAD) on the Cortex-M4.
+*/
+
+#include <math.h>
+#include "audio.h"
+
+#if defined(__arm__) || defined(__ARMCC_VERSION)
+#include <MK64F12.h>
+#define SMUAD(x, y)				__SMUAD((x), (y))
+#define SMLAD(x, y, acc)	__SMLAD((x), (y), (acc))
+#else  //host build
+#define SMUAD(x, y)				smlad((x), (y), 0)
+#define SMLAD(x, y, acc)	smlad((x), (y), (acc))
+static inline uint32_t smlad(uint32_t x, uint32_t y, uint32_t acc) {
+	return acc + (int16_t) x*(int16_t) y + (int16_t) (x >> 16)*(int16_t) (y >> 16);
+}
+#endif
+
+#define PACK(lo, hi) ((uint32_t) (uint16_t) (lo) | (uint32_t) (hi) << 16)
+#define NOISE_FLOOR 48  //mean band level (q15) below which LEDs stay off
+
+struct band {  //struct representing one band-pass filter and its detector
+	uint32_t feed;  //b0 and b2 packed, applied to x[n] and x[n-2]
+	uint32_t back;  //-a1 and -a2 packed, applied to y[n-1] and y[n-2]
+	int16_t x1, x2;  //previous inputs
+	int16_t y1, y2;  //previous outputs
+	int32_t envelope;  //frame level smoothed over a few frames, 8 fractional bits
+	int32_t average;  //slow average of frame level, 8 fractional bits
+	uint8_t on;  //1 if LED is lit
+};
+
+static const float centre[AUDIO_BANDS]= { 100, 300, 800, 2000, 3000 };  //band centres in Hz- all below MIC_RATE/2
+
+//		global variables
+static struct band bands[AUDIO_BANDS];
+static int32_t peak;  //slowly decaying peak of total level
+
+
+/*
+		Helper function that converts a coefficient to q14.
+*/
+static int16_t q14(float c) {
+	return (int16_t) lrintf(c*16384);
+}
+
+
+/*
+		Function that designs the filters for sample_rate and
+		resets the detectors. Bands above the Nyquist frequency
+		stay dark.
+*/
+void audio_init(unsigned int sample_rate) {
+	for (int i= 0; i<AUDIO_BANDS; i++) {  //constant 0 dB peak gain band-pass, one octave wide
+		struct band *b= &bands[i];
+		float w= 2*3.14159265f*centre[i]/sample_rate;
+		float alpha= sinf(w)*sinhf(0.5f*logf(2)*w/sinf(w));
+		float a0= 1 + alpha;
+
+		b->x1= b->x2= b->y1= b->y2= 0;
+		b->envelope= 0;
+		b->average= -1;  //set from first frame
+		b->on= 0;
+		if (w >= 3.14159265f) {  //above Nyquist- filter passes nothing
+			b->feed= 0;
+			b->back= 0;
+			continue;
+		}
+		b->feed= PACK(q14(alpha/a0), q14(-alpha/a0));
+		b->back= PACK(q14(2*cosf(w)/a0), q14(-(1 - alpha)/a0));
+	}
+	peak= 0;
+}
+
+
+/*
+		Helper function that filters count samples through band
+		b. Returns the mean absolute output level.
+*/
+static int32_t filter(struct band *b, const int16_t *samples, int count) {
+	int16_t x1= b->x1, x2= b->x2, y1= b->y1, y2= b->y2;
+	uint32_t sum= 0;
+
+	for (int n= 0; n<count; n++) {
+		int16_t x= samples[n];
+		int32_t acc= (int32_t) SMUAD(PACK(x, x2), b->feed);  //b0*x[n] + b2*x[n-2]
+		acc= (int32_t) SMLAD(PACK(y1, y2), b->back, (uint32_t) acc);  //- a1*y[n-1] - a2*y[n-2]
+		acc>>= 14;
+		if (acc > 32767) acc= 32767;  //saturate
+		else if (acc < -32768) acc= -32768;
+
+		x2= x1;
+		x1= x;
+		y2= y1;
+		y1= (int16_t) acc;
+		sum+= (acc < 0) ? -acc : acc;
+	}
+
+	b->x1= x1;
+	b->x2= x2;
+	b->y1= y1;
+	b->y2= y2;
+	return (int32_t) (sum/count);
+}
+
+
+/*
+		Function that processes one frame of count q15 samples.
+		Sets leds[i] to 1 if band i should be lit and 0 if not,
+		and level to the overall loudness (0 to 255) relative to
+		recent peaks, for PWM brightness.
+*/
+void audio_frame(const int16_t *samples, int count, uint8_t *leds, uint8_t *level) {
+	int32_t total= 0;  //sum of band levels
+
+	for (int i= 0; i<AUDIO_BANDS; i++) {
+		struct band *b= &bands[i];
+		int32_t mean= filter(b, samples, count);
+		if (b->average < 0) b->average= b->envelope= mean << 8;  //first frame
+		b->envelope+= ((mean << 8) - b->envelope) >> 2;  //follow level over about 4 frames
+		b->average+= ((mean << 8) - b->average) >> 8;  //average over about 256 frames
+		int32_t env= b->envelope >> 8;
+		int32_t avg= b->average >> 8;
+
+		total+= env;
+		if (b->on) b->on= env > avg + avg/4 && env > NOISE_FLOOR;  //hysteresis: stay on until close to average
+		else b->on= env > avg + avg/2 && env > NOISE_FLOOR;
+		leds[i]= b->on;
+	}
+
+	if (total > peak) peak= total;
+	else peak-= peak >> 10;  //peak decays over about a second
+	*level= (peak > 0) ? (uint8_t) (total*255/peak) : 0;
+}
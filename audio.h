@@ -0,0 +1,12 @@
+#ifndef __AUDIO_H__
+#define __AUDIO_H__
+
+#include <stdint.h>
+
+#define AUDIO_BANDS 5  //one band per LED, lowest frequency first
+#define AUDIO_FRAME_RATE 1000  //frames per second
+
+void audio_init(unsigned int sample_rate);
+void audio_frame(const int16_t *samples, int count, uint8_t *leds, uint8_t *level);
+
+#endif
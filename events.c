@@ -0,0 +1,121 @@
+/*		This file contains a small lock-free event queue used
+			to hand work from interrupt handlers to the main loop.
+			Any number of interrupt handlers may post events (each
+			one reserves a slot with LDREX/STREX, so nested handlers
+			never collide), but only the main loop reads them. The
+			main loop is therefore the only code that touches the
+			LED pattern, and no interrupts need to be masked.
+			Handlers only record what happened and when; anything
+			slower, such as debouncing, is left to the main loop.
+*/
+
+#include "events.h"
+
+#if defined(__arm__) || defined(__ARMCC_VERSION)
+#include <MK64F12.h>
+#define MEMORY_BARRIER()	__DMB()
+#else  //host build
+#define MEMORY_BARRIER()	__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+#define EVENT_QUEUE_MASK (EVENT_QUEUE_SIZE - 1)
+
+static volatile uint8_t slots[EVENT_QUEUE_SIZE];  //EVENT_NONE marks a free or unpublished slot
+static volatile uint32_t times[EVENT_QUEUE_SIZE];  //time each event happened
+static volatile uint32_t head;  //next slot to reserve- written by producers only
+static volatile uint32_t tail;  //next slot to read- written by the main loop only
+
+
+#if defined(__arm__) || defined(__ARMCC_VERSION)
+/*
+		Helper function that reserves the next free slot by
+		advancing head with LDREX/STREX. If a higher priority
+		handler posts in between, the STREX fails and we retry.
+		Returns 1 if successful and 0 if the queue is full.
+*/
+static int reserve(uint32_t *slot) {
+	uint32_t h;
+
+	do {
+		h= __LDREXW(&head);
+		if (h - tail >= EVENT_QUEUE_SIZE) {  //queue full
+			__CLREX();
+			return 0;
+		}
+	} while (__STREXW(h + 1, &head));  //0 means store succeeded
+
+	*slot= h;
+	return 1;
+}
+#else
+/*
+		Host version of reserve() for simulation, where threads
+		stand in for interrupt handlers.
+*/
+static int reserve(uint32_t *slot) {
+	uint32_t h= __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+
+	do {
+		if (h - tail >= EVENT_QUEUE_SIZE) return 0;  //queue full
+	} while (!__atomic_compare_exchange_n(&head, &h, h + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	*slot= h;
+	return 1;
+}
+#endif
+
+
+/*
+		Function that posts an event from any context along
+		with the time it happened, in whatever units the caller
+		uses. A slot is reserved first, then the event is
+		published by writing it into the slot. Returns 1 if
+		successful and 0 if the queue is full.
+*/
+int event_post(event_type type, uint32_t time) {
+	uint32_t h;  //reserved slot index
+
+	if (!reserve(&h)) return 0;  //drop event
+
+	times[h & EVENT_QUEUE_MASK]= time;
+	MEMORY_BARRIER();  //time must be visible before the event
+	slots[h & EVENT_QUEUE_MASK]= (uint8_t) type;  //publish event
+	MEMORY_BARRIER();
+
+	return 1;  //post successful
+}
+
+
+/*
+		Function that removes the oldest event from the queue
+		and stores the time it was posted with in time. Only the
+		main loop may call this. Returns EVENT_NONE if the queue
+		is empty or the oldest slot has been reserved but not
+		yet published.
+*/
+event_type event_get(uint32_t *time) {
+	uint32_t t= tail;
+	event_type type= (event_type) slots[t & EVENT_QUEUE_MASK];
+
+	if (type == EVENT_NONE) return EVENT_NONE;  //nothing to read yet
+
+	MEMORY_BARRIER();  //read time after seeing the event
+	*time= times[t & EVENT_QUEUE_MASK];
+
+	slots[t & EVENT_QUEUE_MASK]= EVENT_NONE;  //free slot before releasing it
+	MEMORY_BARRIER();
+	tail= t + 1;  //release slot to producers
+
+	return type;
+}
+
+
+/*
+		Function that discards any pending events. Only the
+		main loop may call this.
+*/
+void event_clear(void) {
+	uint32_t time;
+
+	while (event_get(&time) != EVENT_NONE);  //drain queue
+}
@@ -0,0 +1,19 @@
+#ifndef __EVENTS_H__
+#define __EVENTS_H__
+
+#include <stdint.h>
+
+#define EVENT_QUEUE_SIZE 16  //must be a power of two
+
+typedef enum {  //events posted by interrupt handlers
+	EVENT_NONE= 0,  //queue empty (never posted)
+	EVENT_SPEED_UP,  //red button pressed during display
+	EVENT_SLOW_DOWN,  //green button pressed during display
+	EVENT_REVERSE  //white button pressed during display
+} event_type;
+
+int event_post(event_type type, uint32_t time);
+event_type event_get(uint32_t *time);
+void event_clear(void);
+
+#endif
@@ -0,0 +1,114 @@
+/*		This file contains the storage for streaming playback:
+			a serial flash chip (25-series, e.g. W25Q) on SPI0.
+			PTD0 is chip select, PTD1 SCK, PTD2 MOSI and PTD3 MISO
+			(headers D10 to D13 on the FRDM-K64F). A block read
+			sends the read command by hand and then lets two DMA
+			channels do the rest: channel 5 feeds dummy bytes to
+			the transmit FIFO and channel 6 empties the receive
+			FIFO into the buffer, so playback continues while the
+			next block arrives. SCK is half the bus clock, so it
+			follows clock profile switches without reprogramming.
+
+			Write the pattern to the chip at FLASH_PATTERN with any
+			programmer, as raw records from tools/midi2pattern -f
+			raw. Erased flash after it ends the pattern.
+*/
+
+#include <MK64F12.h>
+#include "flash.h"
+
+//		global variables
+static const uint32_t dummy= 0xFF;  //PUSHR word for each byte read: CTAR0, no continuous chip select
+static volatile int busy;  //1 while a block is being read
+
+
+/*
+		Function that initializes SPI0 and the DMA channels for
+		reading the flash.
+*/
+void Flash_Init(void) {
+	SIM->SCGC5 |= (1 << 12);  // Enable Clock to Port D
+	SIM->SCGC6 |= (1 << 12) | (1 << 1);  // Enable Clock to SPI0 and DMAMUX
+	SIM->SCGC7 |= (1 << 1);  // Enable Clock to DMA
+	PORTD->PCR[0] = (1 <<  8);  // Pin PTD0 is GPIO (chip select)
+	PORTD->PCR[1] = (2 <<  8);  // Pin PTD1 is SPI0_SCK
+	PORTD->PCR[2] = (2 <<  8);  // Pin PTD2 is SPI0_SOUT
+	PORTD->PCR[3] = (2 <<  8);  // Pin PTD3 is SPI0_SIN
+	PTD->PSOR = 1 << 0;  //chip not selected
+	PTD->PDDR |= 1 << 0;
+
+	SPI0->MCR = (1u << 31 | 1 << 11 | 1 << 10 | 1 << 0);  //master, clear FIFOs, halted while configuring
+	SPI0->CTAR[0] = (1u << 31 | 7 << 27);  //8-bit frames, mode 0, SCK = bus clock/2
+	SPI0->RSER = (1 << 25 | 1 << 24 | 1 << 17 | 1 << 16);  //transmit FIFO filled and receive FIFO drained by DMA
+	SPI0->MCR &= ~(1 << 0);  //run
+
+	DMA0->TCD[5].SADDR = (uint32_t) &dummy;
+	DMA0->TCD[5].SOFF = 0;
+	DMA0->TCD[5].ATTR = (2 << 8 | 2);  //32-bit reads and writes
+	DMA0->TCD[5].NBYTES_MLNO = 4;  //one PUSHR word per request
+	DMA0->TCD[5].SLAST = 0;
+	DMA0->TCD[5].DADDR = (uint32_t) &SPI0->PUSHR;
+	DMA0->TCD[5].DOFF = 0;
+	DMA0->TCD[5].DLAST_SGA = 0;
+	DMA0->TCD[5].CSR = (1 << 3);  //stop when done
+
+	DMA0->TCD[6].SADDR = (uint32_t) &SPI0->POPR;
+	DMA0->TCD[6].SOFF = 0;
+	DMA0->TCD[6].ATTR = (0 << 8 | 0);  //8-bit reads and writes
+	DMA0->TCD[6].NBYTES_MLNO = 1;  //one byte per request
+	DMA0->TCD[6].SLAST = 0;
+	DMA0->TCD[6].DOFF = 1;
+	DMA0->TCD[6].DLAST_SGA = 0;
+	DMA0->TCD[6].CSR = (1 << 3 | 1 << 1);  //stop and interrupt when done
+
+	DMAMUX->CHCFG[5] = (1 << 7 | 15);  //SPI0 transmit requests
+	DMAMUX->CHCFG[6] = (1 << 7 | 14);  //SPI0 receive requests
+	NVIC_EnableIRQ(DMA6_IRQn);
+}
+
+
+/*
+		Function that starts reading len bytes from flash
+		address into buf. Returns at once; storage_busy() tells
+		when the data has arrived. Only one read may be in
+		progress at a time.
+*/
+void storage_read(uint32_t address, uint8_t *buf, unsigned int len) {
+	uint8_t cmd[4]= {0x03, address >> 16, address >> 8, address};  //read data command and 24-bit address
+
+	busy= 1;
+	PTD->PCOR = 1 << 0;  //select chip
+	for (int i= 0; i<4; i++) SPI0->PUSHR = cmd[i];  //fits in the FIFO
+	for (int i= 0; i<4; i++) {  //discard bytes received meanwhile
+		while (!(SPI0->SR & (1 << 17)));
+		(void) SPI0->POPR;
+		SPI0->SR = (1 << 17);
+	}
+
+	DMA0->TCD[6].DADDR = (uint32_t) buf;
+	DMA0->TCD[6].CITER_ELINKNO = len;
+	DMA0->TCD[6].BITER_ELINKNO = len;
+	DMA0->TCD[5].CITER_ELINKNO = len;
+	DMA0->TCD[5].BITER_ELINKNO = len;
+	DMA0->SERQ = 6;  //receive first so no byte is missed
+	DMA0->SERQ = 5;
+}
+
+
+/*
+		Function that returns 1 while a read is in progress and
+		0 once its data is in the buffer.
+*/
+int storage_busy(void) {
+	return busy;
+}
+
+
+/*
+		DMA channel 6 Interrupt Handler for the end of a read.
+*/
+void DMA6_IRQHandler(void) {
+	DMA0->CINT = 6;  //clear interrupt
+	PTD->PSOR = 1 << 0;  //deselect chip
+	busy= 0;
+}
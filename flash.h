@@ -0,0 +1,11 @@
+#ifndef __FLASH_H__
+#define __FLASH_H__
+
+#include <stdint.h>
+#include "stream.h"
+
+#define FLASH_PATTERN 0  //flash address of the streamed pattern
+
+void Flash_Init(void);
+
+#endif
@@ -0,0 +1,143 @@
+/*		This file contains the hardware side of multi-board
+			synchronization: an interrupt-driven serial link on
+			UART3 (PTC16 receive, PTC17 transmit) that carries
+			sync.c frames between boards, timestamped with the
+			microsecond clock in timebase.c. Connect TX of the
+			leader to RX of every follower and connect the grounds.
+			The link only runs one way, so a board's role is set by
+			wiring too: ground LINK_ROLE_PIN on every follower.
+*/
+
+#include <MK64F12.h>
+#include "link.h"
+
+//		global variables
+static uint8_t tx_buf[SYNC_FRAME_SIZE];  //frame being sent
+static volatile int tx_len;  //number of bytes in tx_buf
+static volatile int tx_pos;  //next byte to send
+
+static volatile uint32_t rx_seq;  //odd while UART3_RX_TX_IRQHandler writes the mailbox
+static volatile uint8_t rx_type;  //mailbox: last frame received
+static volatile uint64_t rx_time;
+static volatile uint32_t rx_arg;
+static volatile uint32_t rx_count;  //mailbox: PIT1 count when frame arrived
+static uint32_t read_seq;  //rx_seq at last Link_Receive()
+
+
+/*
+		Helper function that sets the UART3 baud rate to
+		LINK_BAUD for the current bus clock. Called again by
+		Clock_SetProfile() whenever the bus clock changes.
+*/
+static void set_baud(void) {
+	unsigned int sbr= Clock_Bus()/(16*LINK_BAUD);  //UART3 runs from the bus clock
+	unsigned int brfa= (Clock_Bus()*2/LINK_BAUD) % 32;  //fractional part in 1/32ths
+	uint8_t c2= UART3->C2;
+
+	UART3->C2 = 0;  //disable while configuring
+	UART3->BDH = (sbr >> 8) & 0x1F;
+	UART3->BDL = sbr & 0xFF;
+	UART3->C4 = brfa;
+	UART3->C2 = c2;
+}
+
+
+/*
+		Function that initializes UART3 at LINK_BAUD with
+		receive interrupts enabled.
+*/
+void Link_Init(void) {
+	SIM->SCGC4 |= (1 << 13);  // Enable Clock to UART3
+	SIM->SCGC5 |= (1 << 11);  // Enable Clock to Port C
+	PORTC->PCR[16] = (3 <<  8);  // Pin PTC16 is UART3_RX
+	PORTC->PCR[17] = (3 <<  8);  // Pin PTC17 is UART3_TX
+	PORTC->PCR[LINK_ROLE_PIN] = (1 <<  8 | 1 << 1 | 1 << 0);  // Pin is GPIO input with pullup
+
+	UART3->C2 = 0;  //disable while configuring
+	UART3->C1 = 0;  //8 data bits, no parity
+	set_baud();
+	UART3->C2 = (1 << 5 | 1 << 3 | 1 << 2);  //receive interrupt, transmitter and receiver on
+	Clock_OnChange(set_baud);
+
+	NVIC_EnableIRQ(UART3_RX_TX_IRQn);
+}
+
+
+/*
+		Function that returns 1 if this board leads (role pin
+		left open) and 0 if it follows (role pin grounded).
+*/
+int Link_Leader(void) {
+	return (PTC->PDIR & (1 << LINK_ROLE_PIN)) != 0;
+}
+
+
+/*
+		Function that starts sending a frame. The bytes are sent
+		by UART3_RX_TX_IRQHandler. Returns 1 if successful and 0
+		if the previous frame is still being sent.
+*/
+int Link_Send(sync_type type, uint64_t time, uint32_t arg) {
+	if (tx_pos < tx_len) return 0;  //still busy
+
+	tx_len= sync_encode(tx_buf, type, time, arg);
+	tx_pos= 0;
+	UART3->C2 |= (1 << 7);  //transmit interrupt fires as soon as the data register is empty
+
+	return 1;
+}
+
+
+/*
+		Function that returns the last frame received since the
+		previous call, if any, and the local time in us it
+		arrived. Only the main loop may call this. Returns 1 if
+		a new frame was received and 0 otherwise.
+*/
+int Link_Receive(sync_frame *frame, uint64_t *arrival) {
+	uint32_t seq;
+	uint32_t count;
+
+	do {  //retry if a frame arrives while copying
+		seq= rx_seq;
+		frame->type= rx_type;
+		frame->time= rx_time;
+		frame->arg= rx_arg;
+		count= rx_count;
+	} while (seq != rx_seq);
+
+	if (seq == read_seq) return 0;  //nothing new
+	read_seq= seq;
+
+	*arrival= Clock_At(count);
+
+	return 1;
+}
+
+
+/*
+		UART3 Interrupt Handler for receiving and sending frames.
+		Received frames are timestamped on their last byte and
+		left in the mailbox for Link_Receive().
+*/
+void UART3_RX_TX_IRQHandler(void) {
+	uint32_t count= Clock_Count();  //timestamp first
+	uint8_t status= UART3->S1;
+	sync_frame frame;
+
+	if (status & (1 << 5)) {  //byte received
+		if (sync_parse(UART3->D, &frame)) {
+			rx_seq++;  //mailbox being written
+			rx_type= frame.type;
+			rx_time= frame.time;
+			rx_arg= frame.arg;
+			rx_count= count;
+			rx_seq++;  //mailbox consistent
+		}
+	}
+
+	if ((UART3->C2 & (1 << 7)) && (status & (1 << 7))) {  //ready to send
+		if (tx_pos < tx_len) UART3->D = tx_buf[tx_pos++];
+		else UART3->C2 &= ~(1 << 7);  //frame sent
+	}
+}
@@ -0,0 +1,18 @@
+#ifndef __LINK_H__
+#define __LINK_H__
+
+#include <stdint.h>
+#include <MK64F12.h>
+#include "sync.h"
+#include "timebase.h"
+
+#define LINK_BAUD 115200  //serial link speed between boards
+#define LINK_LATENCY (SYNC_FRAME_SIZE*10*1000000/LINK_BAUD)  //us to send one frame (10 bits per byte)
+#define LINK_ROLE_PIN 4  //PTC4 (D9): leave open on the leader, ground on every follower
+
+void Link_Init(void);
+int Link_Leader(void);
+int Link_Send(sync_type type, uint64_t time, uint32_t arg);
+int Link_Receive(sync_frame *frame, uint64_t *arrival);
+
+#endif
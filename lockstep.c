@@ -0,0 +1,208 @@
+/*		This file contains the playback schedule shared by all
+			boards playing in lockstep. Every board runs the same
+			schedule on the clock disciplined by sync.c: each
+			action is due at a fixed time and the next follows
+			after its wait, so boards that start a loop at the same
+			time with the same speed and direction stay together.
+
+			The leader (set by wiring, see link.c) is the only
+			board that takes button edits. It never applies one at
+			once: it sends the new state in a SYNC_EDIT frame and
+			every board, itself included, applies it at the first
+			action due LOCKSTEP_LEAD or more after that, so the
+			frame always arrives before it is needed. Each loop
+			also starts with a SYNC_START frame carrying the loop's
+			start time and state. A follower that did not start
+			the same loop in the same state (it has just joined,
+			or lost a frame) restarts there.
+
+			Like sync.c it touches no hardware: the caller passes
+			in times and a send function, so the same code runs on
+			the board (patterns.c) and on a PC (sim/sync_sim.c).
+
+			State on the wire (frame arg): scale in bits 0-30 and
+			direction in bit 31.
+*/
+
+#include "lockstep.h"
+#include "sequence.h"
+
+#define STATE(scale, direction)	((uint32_t) (scale) | (uint32_t) (direction) << 31)
+#define STATE_SCALE(state)	((unsigned int) ((state) & PATTERN_SCALE_MAX))
+#define STATE_DIRECTION(state)	((int) ((state) >> 31))
+
+//		global variables
+static int leader;  //1 if this board sends frames, 0 if it receives them
+static int (*step_fn)(unsigned int *wait);  //processes one action
+static void (*restart_fn)(void);  //goes back to the first action
+static int joined;  //1 once playing- the leader always is
+static uint64_t next;  //time in us of next action
+static int looped;  //1 if the next action starts a loop
+static uint32_t state;  //speed and direction being played
+static uint64_t loop_start;  //time in us the current loop started
+static uint32_t loop_state;  //state it started with
+
+static int edit_pending;  //1 if an edit waits for its action
+static uint64_t edit_time;  //earliest action time it applies at
+static uint32_t edit_state;  //state it changes to
+
+static uint32_t wanted;  //leader: state the buttons ask for
+static int send_edit;  //leader: SYNC_EDIT not yet sent
+static int send_start;  //leader: SYNC_START not yet sent
+static uint64_t next_sync;  //leader: local time in us to send next SYNC_CLOCK
+
+static int resync;  //follower: 1 to restart at start_time
+static uint64_t start_time;  //follower: loop start announced by the leader
+static uint32_t start_state;  //follower: state announced with it
+
+
+/*
+		Helper function that plays the pattern in state s from
+		the next action on.
+*/
+static void set_state(uint32_t s) {
+	if (s == state) return;
+	state= s;
+	set_play_state(STATE_SCALE(s), STATE_DIRECTION(s));
+}
+
+
+/*
+		Function that starts a schedule. A leader plays its
+		first action at now (disciplined time in us); a follower
+		waits for the leader's next SYNC_START. step processes
+		one action and stores the wait before the next (see
+		play_step()) and restart makes the next action the first
+		one of the pattern. Call sync_reset() first.
+*/
+void lockstep_begin(int is_leader, uint64_t now, int (*step)(unsigned int *wait), void (*restart)(void)) {
+	unsigned int scale;
+	int direction;
+
+	leader= is_leader;
+	step_fn= step;
+	restart_fn= restart;
+	joined= leader;
+	next= now;
+	looped= 1;
+	edit_pending= 0;
+	send_edit= 0;
+	send_start= 0;
+	next_sync= 0;
+	resync= 0;
+
+	get_play_state(&scale, &direction);
+	state= STATE(scale, direction);
+	wanted= state;
+}
+
+
+/*
+		Function that applies one frame received from the
+		leader, which arrived at local time arrival in us.
+		SYNC_START is only trusted once the clock follows the
+		leader, since its time means nothing before that.
+*/
+void lockstep_receive(const sync_frame *frame, uint64_t arrival) {
+	if (leader) return;  //the link only runs from the leader
+
+	if (frame->type == SYNC_CLOCK) sync_update(frame->time, arrival);
+	else if (frame->type == SYNC_EDIT) {
+		edit_pending= 1;
+		edit_time= frame->time;
+		edit_state= frame->arg;
+	}
+	else if (frame->type == SYNC_START && sync_locked()) {
+		if (joined && frame->time == loop_start && frame->arg == loop_state) return;  //in step
+		resync= 1;  //restart where the leader did
+		start_time= frame->time;
+		start_state= frame->arg;
+	}
+}
+
+
+/*
+		Function that sends the leader's next frame through send
+		if the link is free: a new edit first, then the start of
+		a loop, then a SYNC_CLOCK every SYNC_PERIOD. local is the
+		local time in us. Does nothing on a follower.
+*/
+void lockstep_send(uint64_t local, lockstep_send_fn send) {
+	if (!leader) return;
+
+	if (send_edit) {
+		if (send(SYNC_EDIT, edit_time, edit_state)) send_edit= 0;
+	}
+	else if (send_start) {
+		if (send(SYNC_START, loop_start, loop_state)) send_start= 0;
+	}
+	else if (local >= next_sync) {
+		if (send(SYNC_CLOCK, local, 0)) next_sync= local + SYNC_PERIOD;
+	}
+}
+
+
+/*
+		Function that takes the leader's button edits (see
+		take_edits()) and announces them as one SYNC_EDIT that
+		applies LOCKSTEP_LEAD after now (disciplined time in us).
+		Edits made while one is waiting for its action are held
+		until it has been applied. Does nothing on a follower.
+*/
+void lockstep_edits(uint64_t now, uint32_t debounce) {
+	unsigned int scale= STATE_SCALE(wanted);
+	int direction= STATE_DIRECTION(wanted);
+
+	if (!leader) return;
+
+	if (take_edits(&scale, &direction, debounce)) wanted= STATE(scale, direction);
+	if (edit_pending || wanted == state) return;
+
+	edit_pending= 1;
+	edit_time= now + LOCKSTEP_LEAD;
+	edit_state= wanted;
+	send_edit= 1;
+}
+
+
+/*
+		Function that returns the disciplined time in us the
+		next action is due, or UINT64_MAX while a follower waits
+		to join. During an action it returns that action's time.
+*/
+uint64_t lockstep_next(void) {
+	if (resync) return start_time;
+	return joined ? next : UINT64_MAX;
+}
+
+
+/*
+		Function that processes the action due at
+		lockstep_next(). Call it once that time has come.
+*/
+void lockstep_step(void) {
+	unsigned int wait;  //time until next action in us
+
+	if (resync) {  //follower: restart at the leader's loop
+		resync= 0;
+		joined= 1;
+		restart_fn();
+		next= start_time;
+		looped= 1;
+		set_state(start_state);
+	}
+	if (!joined) return;
+
+	if (edit_pending && next >= edit_time) {  //every board changes at this action
+		edit_pending= 0;
+		set_state(edit_state);
+	}
+	if (looped) {  //tell followers a loop starts now
+		loop_start= next;
+		loop_state= state;
+		send_start= leader;
+	}
+
+	looped= step_fn(&wait);
+	next+= wait;
+}
@@ -0,0 +1,18 @@
+#ifndef __LOCKSTEP_H__
+#define __LOCKSTEP_H__
+
+#include <stdint.h>
+#include "sync.h"
+
+#define LOCKSTEP_LEAD 20000  //time in us from sending an edit to the earliest action it may change
+
+typedef int (*lockstep_send_fn)(sync_type type, uint64_t time, uint32_t arg);  //returns 0 if the link is busy
+
+void lockstep_begin(int leader, uint64_t now, int (*step)(unsigned int *wait), void (*restart)(void));
+void lockstep_receive(const sync_frame *frame, uint64_t arrival);
+void lockstep_send(uint64_t local, lockstep_send_fn send);
+void lockstep_edits(uint64_t now, uint32_t debounce);
+uint64_t lockstep_next(void);
+void lockstep_step(void);
+
+#endif
@@ -9,6 +9,9 @@
 #include "utils.h"
 #include "utils_extern.h"
 #include "patterns.h"
+#include "timebase.h"
+#include "link.h"
+#include "rgb.h"
 
 
 int main (void)
@@ -16,12 +19,28 @@ int main (void)
 	LED_Initialize();  //initialize board LEDs
 	LED_ExInit();  //initialize external LEDs
 	Button_Init();  //initialize buttons
+	Clock_Init();  //start microsecond clock
+	Link_Init();  //initialize serial link to other boards
+	RGB_Init();  //start colour engine for board LED
 	
 	welcome();  //display welcome animation
 	
-	if (mode_select()) freestyle();  //select freestyle mode- stay here until reset
-	else {  //select repetition mode
-		pattern_input();  //user inputs their pattern
+	int mode= mode_select();  //user chooses a mode
+	
+	if (mode == MODE_AUDIO) audio_reactive();  //select audio mode- stay here until reset
+	else {
+		if (mode == MODE_FREESTYLE) {  //select freestyle mode
+			while (!freestyle());  //returns once a session has been captured
+		}
+		else {  //select repetition mode
+#if defined(STREAM_PATTERN)  //long pattern in SPI flash, made by tools/midi2pattern -f raw
+			if (!stream_input()) pattern_input();  //record one if the flash is empty
+#elif defined(BAKED_PATTERN)  //pattern compiled from a MIDI file by tools/midi2pattern
+			if (!load_pattern(baked_pattern, baked_pattern_len)) pattern_input();  //record one if the baked pattern is empty
+#else
+			pattern_input();  //user inputs their pattern
+#endif
+		}
 		modify();  //display which buttons to press to modify the input
 		display();  //display pattern repeatedly and allow modifications- stay here until reset
 	}
@@ -0,0 +1,116 @@
+/*		This file contains the audio input for audio reactive
+			mode. A microphone or line input biased to half the
+			supply goes to PTB2 (ADC0_SE12, header A0). PIT3
+			triggers a conversion MIC_RATE times per second and the
+			DMA copies each result into one half of a double buffer,
+			interrupting when a half (one frame) is full. The CPU
+			only converts the finished half.
+*/
+
+#include <MK64F12.h>
+#include "mic.h"
+#include "timebase.h"
+
+#define ADCK_MAX 18000000  //fastest ADC clock in Hz for 12-bit conversions (K64 datasheet)
+
+//		global variables
+static volatile uint16_t buffer[2*MIC_FRAME];  //two frames of raw 12-bit samples
+static volatile uint32_t frames;  //frames completed- written only by DMA4_IRQHandler
+static volatile int ready;  //half of buffer completed last
+static uint32_t frames_read;  //frames seen by Mic_Read()
+
+
+/*
+		Helper function that sets the PIT3 sample period for the
+		current bus clock. Called again by Clock_SetProfile()
+		whenever the bus clock changes.
+*/
+static void set_rate(void) {
+	PIT->CHANNEL[3].LDVAL = Clock_Bus()/MIC_RATE - 1;  //one sample
+}
+
+
+/*
+		Helper function that divides the bus clock by the
+		smallest power of two (up to 8) that keeps the ADC
+		clock within ADCK_MAX: /1 at 4 MHz, /2 at 21 MHz and /4
+		at the 60 MHz bus of CLOCK_FAST. Called again by
+		Clock_SetProfile() whenever the bus clock changes.
+*/
+static void set_adc_clock(void) {
+	unsigned int adiv= 0;  //divide by 2^adiv
+	
+	while (adiv < 3 && (Clock_Bus() >> adiv) > ADCK_MAX) adiv++;
+	ADC0->CFG1 = (adiv << 5 | 1 << 2);  //bus clock / 2^adiv, 12-bit conversions
+}
+
+
+/*
+		Function that starts sampling. Frames are available
+		from Mic_Read() every millisecond after this.
+*/
+void Mic_Init(void) {
+	SIM->SCGC5 |= (1 << 10);  // Enable Clock to Port B
+	SIM->SCGC6 |= (1 << 27) | (1 << 1) | SIM_SCGC6_PIT_MASK;  // Enable Clock to ADC0, DMAMUX and PIT
+	SIM->SCGC7 |= (1 << 1);  // Enable Clock to DMA
+	PORTB->PCR[2] = 0;  // Pin PTB2 is analog
+
+	set_adc_clock();
+	ADC0->SC3 = (1 << 2);  //average 4 conversions per sample
+	ADC0->SC2 = (1 << 6 | 1 << 2);  //hardware trigger, DMA request when done
+	ADC0->SC1[0] = 12;  //channel SE12
+	SIM->SOPT7 = (1 << 7 | 7);  //ADC0 triggered by PIT3
+
+	DMA0->TCD[4].SADDR = (uint32_t) &ADC0->R[0];
+	DMA0->TCD[4].SOFF = 0;
+	DMA0->TCD[4].ATTR = (1 << 8 | 1);  //16-bit reads and writes
+	DMA0->TCD[4].NBYTES_MLNO = 2;  //one sample per request
+	DMA0->TCD[4].SLAST = 0;
+	DMA0->TCD[4].DADDR = (uint32_t) buffer;
+	DMA0->TCD[4].DOFF = 2;
+	DMA0->TCD[4].DLAST_SGA = -4*MIC_FRAME;  //back to start of buffer
+	DMA0->TCD[4].CITER_ELINKNO = 2*MIC_FRAME;
+	DMA0->TCD[4].BITER_ELINKNO = 2*MIC_FRAME;
+	DMA0->TCD[4].CSR = (1 << 2 | 1 << 1);  //interrupt at half and end of buffer
+
+	DMAMUX->CHCFG[4] = (1 << 7 | 40);  //ADC0 requests
+	NVIC_EnableIRQ(DMA4_IRQn);
+	DMA0->SERQ = 4;  //enable channel 4 requests
+
+	PIT->MCR = (0 << 1);  // enable clock to PIT timers
+	set_rate();
+	PIT->CHANNEL[3].TCTRL = 0x1;  //start timer- triggers ADC, no interrupt
+	Clock_OnChange(set_rate);
+	Clock_OnChange(set_adc_clock);
+	frames_read= frames;
+}
+
+
+/*
+		Function that waits for the next frame and converts it
+		into q15 samples in frame. Returns the number of frames
+		that were missed because the caller was too slow.
+*/
+int Mic_Read(int16_t *frame) {
+	uint32_t done;
+	const volatile uint16_t *half;
+
+	while ((done= frames) == frames_read);  //wait for a frame
+	half= &buffer[ready*MIC_FRAME];
+	for (int n= 0; n<MIC_FRAME; n++) frame[n]= (int16_t) ((half[n] - 2048)*16);  //remove bias, scale to q15
+
+	int missed= (int) (done - frames_read - 1);
+	frames_read= done;
+	return missed;
+}
+
+
+/*
+		DMA4 Interrupt Handler, called each time a frame of
+		samples is complete.
+*/
+void DMA4_IRQHandler(void) {
+	DMA0->CINT = 4;  //clear interrupt
+	ready= (DMA0->TCD[4].CITER_ELINKNO == 2*MIC_FRAME) ? 1 : 0;  //counter reloads after second half
+	frames++;
+}
@@ -0,0 +1,13 @@
+#ifndef __MIC_H__
+#define __MIC_H__
+
+#include <stdint.h>
+#include "audio.h"
+
+#define MIC_RATE 8000  //samples per second
+#define MIC_FRAME (MIC_RATE/AUDIO_FRAME_RATE)  //samples per frame
+
+void Mic_Init(void);
+int Mic_Read(int16_t *frame);
+
+#endif
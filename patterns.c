@@ -1,6 +1,7 @@
-/*		This file contains all of the functions, structs,
-			and variables necessary to create the functionality
-			in main(). The functions in this list are written in
+/*		This file contains the functions and variables that
+			talk to the board to create the functionality in
+			main(). Recording and playback of the pattern itself
+			live in sequence.c. The functions in this list are written in
 			the order in which they are called in main(). If a
 			function has helper functions (several do), the helper
 			functions are written directly above the function.
@@ -11,20 +12,39 @@
 #include "utils_extern.h"
 #include "utils.h"
 #include "patterns.h"
+#include "events.h"
+#include "sequence.h"
+#include "sync.h"
+#include "lockstep.h"
+#include "timebase.h"
+#include "link.h"
+#include "rgb.h"
+#include "audio.h"
+#include "mic.h"
+#include "stream.h"
+#include "flash.h"
 
-struct LED {  //struct representing one LED action (turn on or off)
-	int action;  //1 (turn LED on) or 0 (turn LED off)
-	int num;  //1 (white), 2 (yellow), 3 (red), 4 (blue), or 5 (green)
-	unsigned int delay;  //time in ms since previous button press or release
-	struct LED *next; //next LED_action in linked list (for normal traversal)
-	struct LED *prev;  //previous LED_action in linked list (for reverse traversal)
+//		global variables
+int streaming;  //1 if display() plays the pattern streamed from flash instead of a published one
+
+#define DEBOUNCE_MS 10  //button edges closer than this to the last one are contact bounce
+
+#define CAPTURE_SIZE 128  //must be a power of two
+
+struct capture {  //one change of the LEDs seen by the button interrupt handlers
+	uint32_t count;  //Clock_Count() at change
+	uint32_t leds;  //port C LED bits after change
 };
 
-//		global variables
-LED_action *head;  //start of LED list
-int max_num= 45;  //maximum number of LED presses allowed
-unsigned int current_time;  //elapsed time in ms since last LED action
-int direction= 1;  //1 (normal) or 0 (reverse) for list traversal
+volatile int mirroring;  //1 while freestyle() owns the button interrupts
+volatile int capturing;  //1 while freestyle() records the session
+struct capture captured[CAPTURE_SIZE];  //changes waiting to be recorded
+volatile uint32_t capture_head;  //written only by button interrupt handlers
+volatile uint32_t capture_tail;  //written only by freestyle()
+volatile uint32_t mirror_worst;  //longest handler-entry-to-light time in cycles
+uint32_t recorded_leds;  //LED bits as last recorded by drain_captures()
+uint32_t debounce_ready;  //LED bits with no recorded edge yet
+uint32_t latency_ns;  //mirror_worst in ns- read with a debugger
 
 
 /*
@@ -34,24 +54,24 @@ int direction= 1;  //1 (normal) or 0 (reverse) for list traversal
 */
 void welcome(void) {
 	int j;
-	int wait= 0; //animation starts fast
+	unsigned int wait= 0; //time in us each LED stays on- animation starts fast
 	
 	for (int i= 0; i<12; i++) {  //do sliding animation 10 times
-		wait= wait + 50000;  //animation gets slower
+		wait= wait + 10000;  //animation gets slower
 		White_On();
-		for(j=0; j<wait; j++);  //do nothing
+		Clock_Delay(wait);
 		White_Off();
 		Yellow_On();
-		for(j=0; j<wait; j++);
+		Clock_Delay(wait);
 		Yellow_Off();
 		Red_On();
-		for(j=0; j<wait; j++);
+		Clock_Delay(wait);
 		Red_Off();
 		Blue_On();
-		for(j=0; j<wait; j++);
+		Clock_Delay(wait);
 		Blue_Off();
 		Green_On();
-		for(j=0; j<wait; j++);
+		Clock_Delay(wait);
 		Green_Off();
 	}
 	
@@ -75,28 +95,31 @@ void welcome(void) {
 /*
 		Function that lets users choose which interactive
 		mode they want to use and visually displays their 
-		options. Returns 1 for freestyle mode and 0 for 
-		repetition mode.
+		options. Returns MODE_FREESTYLE, MODE_AUDIO or
+		MODE_REPETITION.
 */
 int mode_select(void) {
 	Yellow_On();  //yellow represents freestyle mode
+	Red_On();  //red represents audio mode
 	Blue_On();  //blue represents repetition mode
 	
-	int result= 2;  //return value
+	int result= -1;  //return value
 	
-	while(result == 2) {  //polling
-		if (PTC->PDIR & (1 << 2)) result= 1;  //choose freestyle mode
-		if (PTB->PDIR & (1 << 9)) result= 0;  //choose repetition mode
+	while(result == -1) {  //polling
+		if (Button_Read(Yellow_NUM)) result= MODE_FREESTYLE;  //choose freestyle mode
+		if (Button_Read(Red_NUM)) result= MODE_AUDIO;  //choose audio mode
+		if (Button_Read(Blue_NUM)) result= MODE_REPETITION;  //choose repetition mode
 	}
 	
-	if (result) {  //freestyle selected
-		Blue_Off();  //display selection
-		for (int j=0; j<6000000; j++);
-		Yellow_Off();
-	} else {  //repetition selected
-		Yellow_Off();  //display selection
-		for (int j=0; j<6000000; j++);
-		Blue_Off();
+	if (result != MODE_FREESTYLE) Yellow_Off();  //display selection
+	if (result != MODE_AUDIO) Red_Off();
+	if (result != MODE_REPETITION) Blue_Off();
+	Clock_Delay(1200000);
+	Yellow_Off();
+	Red_Off();
+	Blue_Off();
+	
+	if (result == MODE_REPETITION) {  //give user time to get ready
 		delay();
 		delay();
 	}
@@ -105,26 +128,196 @@ int mode_select(void) {
 }
 
 
+#define BUTTON_LED(name, pin, port, button)	| ((pdir_##port >> button) & 1) << pin
+#define BUTTON_LEDS (0 EXTERN_LEDS(BUTTON_LED))  //LED bits of the buttons held in pdir_B and pdir_C
+
+
 /*
-		Function for freestyle mode. Users can press any button
-		and light up its corresponding LED.
+		Helper function that lights the LEDs of the buttons that
+		are pressed. Called by the button interrupt handlers in
+		freestyle mode with the cycle count they read on entry.
+		Both ports are read once and the LEDs that changed are
+		toggled with a single port write. The time from handler
+		entry to write is kept in mirror_worst; the exception
+		entry before the handler's first instruction (at least
+		12 cycles) is not included. If capturing, the change is
+		queued for freestyle() to record.
 */
-void freestyle(void) {
-	while(1) {  //polling
-		if (PTC->PDIR & (1 << 3)) White_On();  //press for white
-		else White_Off();
-		
-		if (PTC->PDIR & (1 << 2)) Yellow_On();  //press for yellow
-		else Yellow_Off();
+static inline void mirror(uint32_t entry) {
+	uint32_t pdir_C= PTC->PDIR;
+	uint32_t pdir_B= PTB->PDIR;
+	uint32_t want= BUTTON_LEDS;
+	uint32_t changed= (want ^ PTC->PDOR) & EXTERN_LED_MASK;
+	
+	PTC->PTOR = changed;  //toggle only LEDs that changed
+	
+	uint32_t took= DWT->CYCCNT - entry;
+	if (took > mirror_worst) mirror_worst= took;
+	
+	if (capturing && changed && capture_head - capture_tail < CAPTURE_SIZE) {  //drop if full
+		captured[capture_head & (CAPTURE_SIZE - 1)].count= Clock_Count();
+		captured[capture_head & (CAPTURE_SIZE - 1)].leds= want;
+		capture_head++;
+	}
+}
+
+
+/*
+		Helper function that starts recording the changes queued
+		by mirror() from now on, with every LED off.
+*/
+void capture_begin(void) {
+	capture_tail= capture_head;  //forget older changes
+	recorded_leds= 0;
+	debounce_ready= EXTERN_LED_MASK;  //no edge seen yet
+	capturing= 1;
+}
+
+
+/*
+		Helper function that records every change queued by
+		mirror() since it was last called. The LEDs follow every
+		edge, but an edge of a button less than DEBOUNCE_MS after
+		the last one recorded for it is contact bounce and is not
+		recorded. A quicker real press is recorded late, with
+		the next change after the window.
+*/
+void drain_captures(void) {
+	static uint32_t last[6];  //Clock_Count() of last recorded edge, indexed by LED number
+	uint32_t window= Clock_Bus()/1000*DEBOUNCE_MS;  //in bus cycles, like Clock_Count()
+	
+	while (capture_tail != capture_head) {
+		struct capture *cap= &captured[capture_tail & (CAPTURE_SIZE - 1)];
+		unsigned int now= Clock_At(cap->count)/1000;  //time in ms
 		
-		if (PTB->PDIR & (1 << 23)) Red_On();  //press for red
-		else Red_Off();
+		for (int num= 1; num<=5; num++) {
+			uint32_t bit= 1 << extern_led_pin[num];
+			
+			if (!((cap->leds ^ recorded_leds) & bit)) continue;  //no change
+			if (!(debounce_ready & bit) && cap->count - last[num] < window) continue;  //bounce
+			record_edge(num, (cap->leds & bit) != 0, now);
+			recorded_leds^= bit;
+			debounce_ready&= ~bit;
+			last[num]= cap->count;
+		}
+		capture_tail++;
+	}
+}
+
+
+/*
+		Helper function that tells the user a recording could
+		not start because both recording buffers still hold
+		patterns playback may use: the board LED flashes red
+		twice.
+*/
+static void refuse(void) {
+	for (int i= 0; i<2; i++) {
+		RGB_Set(RGB(64, 0, 0));
+		delay();
+		RGB_Set(RGB(0, 0, 0));
+		delay();
+	}
+}
+
+
+/*
+		Helper function that sets the board LED for freestyle
+		mode: blue while capturing, otherwise green if every
+		press so far lit its LED within 2 us of handler entry
+		and red if not.
+*/
+void freestyle_status(void) {
+	latency_ns= (uint64_t) mirror_worst*1000000000/SystemCoreClock;
+	
+	if (capturing) RGB_Set(RGB(0, 0, 64));
+	else if (latency_ns < 2000) RGB_Set(RGB(0, 32, 0));
+	else RGB_Set(RGB(32, 0, 0));
+}
+
+
+/*
+		Function for freestyle mode. Users can press any button
+		and light up its corresponding LED. The LEDs are driven
+		from the button interrupts, so the main loop only
+		watches the start button: the first press starts
+		capturing the session, the second press stops it.
+		A capture that cannot start (see record_start()) is
+		refused and the LEDs keep following the buttons.
+		Returns 1 if a session was captured and published and
+		0 if it was empty.
+*/
+int freestyle(void) {
+	int start_prev= 0;  //variables to monitor start button
+	int start_cur= 0;
+	uint32_t worst_seen= 0;  //mirror_worst last shown
+	
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;  //enable cycle counter
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	
+	for (int num= 1; num<=5; num++) *Button_PCR(num) |= (0xB << 16);  //interrupt on either edge
+	
+	Clock_SetProfile(CLOCK_FAST);  //shortest press-to-light time
+	mirroring= 1;
+	mirror(DWT->CYCCNT);  //show buttons already held
+	freestyle_status();
+	NVIC_EnableIRQ(PORTC_IRQn);  //enable port C interrupts
+	NVIC_EnableIRQ(PORTB_IRQn);  //enable port B interrupts
+	
+	while(1) {  //polling start button only
+		start_prev= start_cur;
+		start_cur= (PTC->PDIR & (1 << 12)) ? 1 : 0;
 		
-		if (PTB->PDIR & (1 << 9)) Blue_On();  //press for blue
-		else Blue_Off();
+		if (!start_prev && start_cur) {  //start or stop capture
+			delay();  //debounce- LEDs keep following buttons meanwhile
+			if (capturing) break;
+			if (record_start(Clock_Now()/1000)) capture_begin();
+			else refuse();  //both buffers still in use
+			freestyle_status();
+		}
 		
-		if (PTB->PDIR & (1 << 18)) Green_On();  //press for green
-		else Green_Off();
+		drain_captures();
+		if (mirror_worst != worst_seen) {  //new worst latency
+			worst_seen= mirror_worst;
+			freestyle_status();
+		}
+	}
+	
+	capturing= 0;
+	drain_captures();
+	NVIC_DisableIRQ(PORTC_IRQn);  //give button interrupts back to display()
+	NVIC_DisableIRQ(PORTB_IRQn);
+	mirroring= 0;
+	for (int num= 1; num<=5; num++) *Button_PCR(num) &= ~(0xF << 16);  //no interrupts
+	RGB_Set(RGB(0, 0, 0));
+	Clock_SetProfile(CLOCK_RESET);
+	
+	for (int num= 1; num<=5; num++) led_set(num, 0);
+	
+	return record_finish() > 0;
+}
+
+
+/*
+		Function for audio reactive mode. Each LED lights with
+		the beat in its own frequency band, from white (bass) to
+		green (treble), and the board LED glows with overall
+		loudness.
+*/
+void audio_reactive(void) {
+	int16_t frame[MIC_FRAME];  //1 ms of samples
+	uint8_t leds[AUDIO_BANDS];  //1 if band's LED should be lit
+	uint8_t level;  //loudness (0 to 255)
+	
+	Clock_SetProfile(CLOCK_FAST);  //leave the signal processing plenty of each ms
+	audio_init(MIC_RATE);
+	Mic_Init();
+	
+	while(1) {  //one frame per ms
+		Mic_Read(frame);  //wait for next frame
+		audio_frame(frame, MIC_FRAME, leds, &level);
+		for (int num= 1; num<=5; num++) led_set(num, leds[num - 1]);
+		RGB_Set(RGB(level, level/4, 0));  //warm glow
 	}
 }
 
@@ -157,174 +350,58 @@ void countdown(void) {
 
 
 /*
-		Helper function that creates a circular doubly linked list 
-		representing user's LED pattern input. This list is 
-		created by appending LED_action structs to the end of 
-		the list. Returns 1 if successful and 0 if unsuccessful.
-*/
-int append(int action, int num) {
-	NVIC_DisableIRQ(PIT0_IRQn);  //keep time where it's at
-	LED_action *new = (malloc(sizeof(LED_action))); //allocate LED_action space and return pointer
-	if (new == NULL) return 0; //allocation failed
-	
-	new->delay= current_time*(SystemCoreClock/1000);  //number of cycles since last LED action
-	
-	new->action= action;  //on or off
-	new->num= num;  //LED number
-	
-	if (head == NULL) {  //if list is empty
-		head= new;  //only element in list
-		new->next= new;  //element points to itself
-		new->prev= new;  //in both directions
-	}
-	else {  //list not empty; new is the tail now
-		new->next= head;
-		new->prev= head->prev;
-		head->prev->next= new;
-		head->prev= new;
-	}
-	
-	current_time= 0;  //reset time to measure next press
-	NVIC_EnableIRQ(PIT0_IRQn);  //start incrementing again
-	
-	return 1;  //append successful
-}
-
-
-/*
-		Helper function that enables a timer that will 
-		help record what a user inputs in real-time in 
-		pattern_input().
-*/
-void timer_enable(void) {
-	SIM->SCGC6 = SIM_SCGC6_PIT_MASK; // enable clock to PIT module
-	PIT->MCR = (0 << 1); // enable clock to PIT timers
-	NVIC_EnableIRQ(PIT0_IRQn); //enable PIT0 interrupts
-	PIT->CHANNEL[0].LDVAL = SystemCoreClock/1000;  //interrupt once every ms
-	PIT->CHANNEL[0].TFLG = 0x1; // Write 1 to this flag to clear it
-
-	current_time= 0;  //current time starts at zero
-	
-	PIT->CHANNEL[0].TCTRL |= 0x3; //enable interrupts and start current time
-}
-
-
-/*
-		Function for storing user inputs in a linked list and
-		converting them into the desired LED sequence.
+		Function for recording user inputs and publishing them
+		as the LED pattern. Presses are timed in ms from
+		Clock_Now(), like freestyle(). If recording cannot
+		start (see record_start()), it is refused and the
+		pattern already published is kept.
 */
 void pattern_input(void) {
 	countdown();  //animation tells user when to start inputting
-	int press_num= 0;  //number of buttons pressed
-	unsigned int milli= SystemCoreClock/1000;  //millisecond delay value
-	unsigned int i;  //for loop variable
-	
-	int w_prev= 0;  //values to monitor button presses
-	int w_cur= 0;	  //buttons named based on LED they control
-	int y_prev= 0;	//0 or low means button wasn't pressed
-	int y_cur= 0;		//1 or high means button was pressed
-	int r_prev= 0;	//each loop cycle, check current value and store previous
-	int r_cur= 0;		//compare these values to detect button press/release
-	int b_prev= 0;	//initially no buttons have been pressed
-	int b_cur= 0;
-	int g_prev= 0;
-	int g_cur= 0;
-	
-	timer_enable();  //measure elapsed time between button presses
+	int num;  //LED number
+	int changed;  //number of presses or releases seen this loop
+	int result;  //result of recording one button
+	
+	if (!record_start(Clock_Now()/1000)) {  //both buffers still in use
+		refuse();
+		return;
+	}
 	
 	while(1) {  //polling
-		w_prev= w_cur;  //current press becomes previous
-		y_prev= y_cur;
-		r_prev= r_cur;
-		b_prev= b_cur;
-		g_prev= g_cur;
-		
-		w_cur= (PTC->PDIR & (1 << 3)) ? 1 : 0;  //check if button is pressed
-		y_cur= (PTC->PDIR & (1 << 2)) ? 1 : 0;  //update current press
-		r_cur= (PTB->PDIR & (1 << 23)) ? 1 : 0;  //1 means button is pressed
-		b_cur= (PTB->PDIR & (1 << 9)) ? 1 : 0;  //0 means button isn't pressed
-		g_cur= (PTB->PDIR & (1 << 18)) ? 1 : 0;
-
-		if (!w_prev && w_cur && press_num < max_num) {  //white pressed and list not full
-			for (i=0; i<milli; i++);  //debounce
-			if (append(1,1)) White_On();  //if append is successful, white on
-			else return;  //this should never happen
-		}
-		else if (w_prev && !w_cur && press_num < max_num) {  //white released and list not full
-			for (i=0; i<milli; i++);  //debounce
-			if (append(0,1)) {
-				White_Off();
-				press_num++;  //count button press
-			}
-			else return;
-		}
-		
-		if (!y_prev && y_cur && press_num < max_num) {  //yellow pressed and list not full
-			for (i=0; i<milli; i++);  //debounce
-			if (append(1,2)) Yellow_On();  //if append is successful, yellow on
-			else return;  //this should never happen
-		}
-		else if (y_prev && !y_cur && press_num < max_num) {  //yellow released and list not full
-			for (i=0; i<milli; i++);  //debounce
-			if (append(0,2)) {
-				Yellow_Off();
-				press_num++;  //count button press
+		changed= 0;
+		for (num= 1; num<=5; num++) {  //check every button
+			result= record_button(num, Button_Read(num), Clock_Now()/1000);  //time in ms
+			if (result < 0) {  //out of memory- keep what was recorded
+				record_finish();
+				return;
 			}
-			else return;
-		}
-		
-		if (!r_prev && r_cur && press_num < max_num) {  //red pressed and list not full
-			for (i=0; i<milli; i++);  //debounce
-			if (append(1,3)) Red_On();  //if append is successful, red on
-			else return;  //this should never happen
-		}
-		else if (r_prev && !r_cur && press_num < max_num) {  //red released and list not full
-			for (i=0; i<milli; i++);  //debounce
-			if (append(0,3)) {
-				Red_Off();
-				press_num++;  //count button press
-			}
-			else return;
-		}
-		
-		if (!b_prev && b_cur && press_num < max_num) {  //blue pressed and list not full
-			for (i=0; i<milli; i++);  //debounce
-			if (append(1,4)) Blue_On();  //if append is successful, blue on
-			else return;  //this should never happen
-		}
-		else if (b_prev && !b_cur && press_num < max_num) {  //blue released and list not full
-			for (i=0; i<milli; i++);  //debounce
-			if (append(0,4)) {
-				Blue_Off();
-				press_num++;  //count button press
-			}
-			else return;
-		}
-		
-		if (!g_prev && g_cur && press_num < max_num) {  //green pressed and list not full
-			for (i=0; i<milli; i++);  //debounce
-			if (append(1,5)) Green_On();  //if append is successful, green on
-			else return;  //this should never happen
-		}
-		else if (g_prev && !g_cur && press_num < max_num) {  //green released and list not full
-			for (i=0; i<milli; i++);  //debounce
-			if (append(0,5)) {
-				Green_Off();
-				press_num++;  //count button press
-			}
-			else return;
+			changed+= result;
 		}
+		if (changed) Clock_Delay(1000);  //debounce
 
 		//exit loop by pressing max number of buttons or pressing non-LED button
-		if ((press_num == max_num) || (PTC->PDIR & (1 << 12))) {
-			for (i=0; i<milli; i++);  //debounce
-			NVIC_DisableIRQ(PIT0_IRQn);  //timer no longer needed
+		if (record_full() || (PTC->PDIR & (1 << 12))) {
+			Clock_Delay(1000);  //debounce
+			record_finish();  //play it from display()
 			return;
 		}
 	}
 }
 
 
+/*
+		Function that plays a pattern streamed from SPI flash
+		instead of storing user inputs. The pattern can be far
+		longer than RAM allows. Returns 1 if successful and 0
+		if the flash holds no pattern.
+*/
+int stream_input(void) {
+	Flash_Init();
+	streaming= stream_open(FLASH_PATTERN);
+	return streaming;
+}
+
+
 /*
 		Function that marks transition from pattern input
 		stage to pattern display stage. LEDs corresponding 
@@ -337,16 +414,18 @@ void modify(void) {
 	
 	int red_on= 0;  //red initially off
 	int green_on= 0;  //green initially off
-	int blink= 0;  //used to decide when to blink LEDs
+	uint64_t next_red= Clock_Now();  //time in us to toggle red
+	uint64_t next_green= next_red;  //time in us to toggle green
 	int start_prev= 1;  //variables to monitor start button
 	int start_cur= 1;
 	
 	while(1) {  //polling and flashing red and blue LEDs
 		start_prev= start_cur;
 		start_cur= (PTC->PDIR & (1 << 12)) ? 1 : 0;  //check if button is pressed
-		blink++;  //keep incrementing blink
+		uint64_t now= Clock_Now();
 		
-		if (blink%100000 == 0) {  //blink fast
+		if (now >= next_red) {  //blink fast
+			next_red+= 100000;
 			if (red_on) {  //if red is on, turn it off
 				Red_Off();
 				red_on= 0;
@@ -355,7 +434,8 @@ void modify(void) {
 				red_on= 1;
 			}
 		}
-		if (blink == 1000000) {  //blink slow
+		if (now >= next_green) {  //blink slow
+			next_green+= 1000000;
 			if (green_on) {  //if green is on, turn it off
 				Green_Off();
 				green_on= 0;
@@ -363,7 +443,6 @@ void modify(void) {
 				Green_On();
 				green_on= 1;
 			}
-			blink= 0;  //reset blink
 		}
 		if (!start_prev && start_cur) {  //press non-LED button to start displaying pattern
 			White_Off();  //turn LEDs off
@@ -380,119 +459,147 @@ void modify(void) {
 		corresponding to the white, red, and green LEDs.
 */
 void interrupt_enable(void) {
-	PORTC->PCR[3] |= (1 <<  16 | 1 << 19);  //interrupt on rising edge
-	PORTB->PCR[23] |= (1 <<  16 | 1 << 19);
-	PORTB->PCR[18] |= (1 <<  16 | 1 << 19);
+	*Button_PCR(White_NUM) |= (1 <<  16 | 1 << 19);  //interrupt on rising edge
+	*Button_PCR(Red_NUM) |= (1 <<  16 | 1 << 19);
+	*Button_PCR(Green_NUM) |= (1 <<  16 | 1 << 19);
+	
+	event_clear();  //start with no pending button events
 	
 	NVIC_EnableIRQ(PORTC_IRQn);  //enable port C interrupts
 	NVIC_EnableIRQ(PORTB_IRQn);  //enable port B interrupts
 }
 
 
+/*
+		Function that turns LED num on (on is 1) or off
+		(on is 0). Called by the recorder and by playback.
+*/
+void led_set(int num, int on) {
+	LED_Write(num, on);  //single bit-band store
+}
+
+
+/*
+		Helper function that keeps the serial link going while
+		display() waits: hands received frames to lockstep.c and
+		sends whatever it has queued. On the leader it also
+		takes button presses, which lockstep.c sends to the
+		followers before any board applies them.
+*/
+void link_service(void) {
+	sync_frame frame;
+	uint64_t arrival;  //local time frame arrived in us
+	
+	if (Link_Receive(&frame, &arrival)) lockstep_receive(&frame, arrival);
+	lockstep_send(Clock_Now(), Link_Send);
+	if (!streaming) lockstep_edits(sync_time(Clock_Now()), Clock_Bus()/1000*DEBOUNCE_MS);  //debounce in bus cycles
+}
+
+
+/*
+		Helper function that restarts the streamed pattern when
+		a follower rejoins the leader's loop.
+*/
+static void stream_restart(void) {
+	stream_open(FLASH_PATTERN);
+}
+
+
 /*
 		Function that displays the user's pattern repeatedly.
-		It does so by iterating through the linked list and
-		processing the action each element represents.
+		It does so by stepping through the newest published
+		pattern and processing each action in turn. Actions
+		are scheduled by lockstep.c on the clock shared by all
+		connected boards. Whether this board leads is set by
+		wiring (see link.c), and only the leader takes button
+		presses; followers start with the leader's next loop
+		and follow its edits. A streamed pattern cannot be
+		modified, so the buttons are left off.
 */
 void display(void) {
-	interrupt_enable();  //enable button interrupts
-	int i;  //loop variable
-	LED_action *elem= head;  //start at head
+	int leader= Link_Leader();  //1 if this board leads playback, 0 if it follows another board
+	
+	Clock_SetProfile(CLOCK_LOW);  //playback mostly waits- save power
+	RGB_Fade(leader ? RGB(0, 64, 0) : RGB(0, 0, 64), 1000);  //glow green when leading, blue when following
+	sync_reset(LINK_LATENCY);
+	if (streaming) lockstep_begin(leader, Clock_Now(), stream_step, stream_restart);
+	else lockstep_begin(leader, Clock_Now(), play_step, play_restart);
+	if (leader && !streaming) interrupt_enable();  //enable button interrupts
 	
 	while (1) {  //infinitely loop through LED sequence
-		if (elem->num == 1) {  //white LED
-			(elem->action) ? White_On() : White_Off();  //choose action
-		}
-		else if (elem->num == 2) {  //yellow LED
-			(elem->action) ? Yellow_On() : Yellow_Off();  //choose action
-		}
-		else if (elem->num == 3) {  //red LED
-			(elem->action) ? Red_On() : Red_Off();  //choose action
-		}
-		else if (elem->num == 4) {  //blue LED
-			(elem->action) ? Blue_On() : Blue_Off();  //choose action
-		}
-		else if (elem->num == 5) {  //green LED
-			(elem->action) ? Green_On() : Green_Off();
-		}
-		
-		if (direction) {  //traverse normally
-			elem= elem->next;  //get next LED action in list
-			unsigned int num_loops= (elem->delay)/4;  //compute delay
-			for (i= 0; i< num_loops; i++);  //delay
-		} else {  //traverse in reverse- must get next element and the delay in opposite order
-			unsigned int num_loops= (elem->delay)/4;  //get delay in number of cycles
-			elem= elem->prev;  //get prev element in list
-			for (i= 0; i< num_loops; i++);  //delay
-		}
+		while (sync_time(Clock_Now()) < lockstep_next()) link_service();  //delay
+		lockstep_step();  //process action and get next one
 	}
 }
 
 
-/* 
-     PIT0 Interrupt Handler for incrementing current time by 1 ms.
+/*
+		Helper function for the button interrupt handlers that
+		posts an event, at time now, for each edit button whose
+		interrupt flag is set, and clears the flag. Red speeds
+		the pattern up, green slows it down and white reverses
+		it. The buttons' ports come from EXTERN_LEDS, so either
+		handler may find any of them.
 */
-void PIT0_IRQHandler(void) {
-	NVIC_ClearPendingIRQ(PIT0_IRQn); // Clear PIT0 interrupts
-	PIT->CHANNEL[0].TFLG = 0x1; // Write 1 to this flag to clear it
-	PIT->CHANNEL[0].TCTRL &= 0x2; // Disable timer
-	current_time++;  //increment time
-	PIT->CHANNEL[0].TCTRL |= (1 << 0); //restart countdown
+static void post_edits(uint32_t now) {
+	if (*Button_PCR(Red_NUM) & (1 << 24)) {  //if red pressed, speed up
+		*Button_PCR(Red_NUM) |= (1 << 24);  //clear interrupt flag
+		event_post(EVENT_SPEED_UP, now);
+	}
+	if (*Button_PCR(Green_NUM) & (1 << 24)) {  //if green pressed, slow down
+		*Button_PCR(Green_NUM) |= (1 << 24);  //clear interrupt flag
+		event_post(EVENT_SLOW_DOWN, now);
+	}
+	if (*Button_PCR(White_NUM) & (1 << 24)) {  //if white pressed, reverse
+		*Button_PCR(White_NUM) |= (1 << 24);  //clear interrupt flag
+		event_post(EVENT_REVERSE, now);
+	}
 }
 
 
 /* 
-		PORTB Interrupt Handler for changing speed of LED pattern
-		as it is displayed.
+		PORTB Interrupt Handler for the edit buttons on port B
+		(speed up and slow down with the current wiring) while
+		the pattern is displayed. It only posts the edge and its
+		time; display() debounces and makes the change.
+		In freestyle mode it mirrors the buttons instead.
 */
 void PORTB_IRQHandler(void) {
-	NVIC_DisableIRQ(PORTB_IRQn); //no interrupts here
-	NVIC_ClearPendingIRQ(PORTB_IRQn); // Clear port B interrupts
-	unsigned int milli= SystemCoreClock/1000;  //millisecond delay value
-	for (int i=0; i<milli; i++);  //debounce
+	uint32_t entry= DWT->CYCCNT;  //first thing, for mirror()'s latency
+	uint32_t now;  //time of the edge in bus cycles
 	
-	int speed;  //used to determine whether to speed up or slow down
-	if (PORTB->PCR[23] & (1 << 24)) {  //if red pressed, speed up
-		speed= 1;
-		PORTB->PCR[23] |= (1 << 24);  //clear interrupt flag
-	}
-	else if (PORTB->PCR[18] & (1 << 24)) {  //if green pressed, slow down
-		speed= 0;
-		PORTB->PCR[18] |= (1 << 24);  //clear interrupt flag
+	if (mirroring) {  //freestyle mode
+		PORTB->ISFR = PORTB->ISFR;  //clear flags before reading pins
+		mirror(entry);
+		return;
 	}
 	
-	LED_action *tmp= head;
-	int done=0;  //indicates whether all elements have been modified
-	while (!done) {  //elements left to modify
-		tmp->delay= (speed) ? (tmp->delay)*.75 : (tmp->delay)*1.25;  //modify speed
-		if (tmp->next == head) done= 1;  //all elements have been modified
-		else tmp= tmp->next;  //otherwise move to next element
-	}
-
-	NVIC_EnableIRQ(PORTB_IRQn); //enable interrupts
+	now= Clock_Count();
+	
+	NVIC_ClearPendingIRQ(PORTB_IRQn); // Clear port B interrupts
+	post_edits(now);
 }
 
 
 /* 
-		PORTC Interrupt Handler for reversing direction
-		of LED pattern that user created.
+		PORTC Interrupt Handler for the edit buttons on port C
+		(reverse with the current wiring) while the pattern is
+		displayed. It only posts the edge and its time;
+		display() debounces and makes the change. In freestyle
+		mode it mirrors the buttons instead.
 */
 void PORTC_IRQHandler(void) {
-	NVIC_DisableIRQ(PORTC_IRQn); //no interrupts here
-	NVIC_ClearPendingIRQ(PORTC_IRQn); // Clear port C interrupts
-	PORTC->PCR[3] |= (1 << 24);  //clear interrupt flag
-	unsigned int milli= SystemCoreClock/1000;  //millisecond delay value
-	for (int i=0; i<milli; i++);  //debounce
-	
-	LED_action *tmp= head;
-	int done=0;  //indicates whether all elements have been modified
-	while (!done) {  //elements left to modify
-		tmp->action= !(tmp->action);  //reversing traversal reverses actions
-		if (tmp->next == head) done= 1;  //all elements have been modified
-		else tmp= tmp->next;  //otherwise move to next element
+	uint32_t entry= DWT->CYCCNT;  //first thing, for mirror()'s latency
+	uint32_t now;  //time of the edge in bus cycles
+	
+	if (mirroring) {  //freestyle mode
+		PORTC->ISFR = PORTC->ISFR;  //clear flags before reading pins
+		mirror(entry);
+		return;
 	}
 	
-	direction= !direction;  //change traversal direction
-
-	NVIC_EnableIRQ(PORTC_IRQn); //enable interrupts
+	now= Clock_Count();
+	
+	NVIC_ClearPendingIRQ(PORTC_IRQn); // Clear port C interrupts
+	post_edits(now);
 }
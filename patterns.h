@@ -4,13 +4,18 @@
 #include <stdlib.h>
 #include <MK64F12.h>
 
-struct LED;
-typedef struct LED LED_action;
+#include "sequence.h"
+
+#define MODE_REPETITION 0  //values returned by mode_select()
+#define MODE_FREESTYLE 1
+#define MODE_AUDIO 2
 
 void welcome(void);
 int mode_select(void);
-void freestyle(void);
+int freestyle(void);
+void audio_reactive(void);
 void pattern_input(void);
+int stream_input(void);
 void modify(void);
 void display(void);
 
@@ -0,0 +1,193 @@
+/*		This file contains a colour engine for the onboard RGB
+			LED. The LED pins (PTB22 red, PTE26 green, PTB21 blue)
+			have no FlexTimer channel, so PWM is made by the DMA
+			instead: PIT2 ticks RGB_STEPS times per period and each
+			tick makes DMA channel 2 copy the next word of a table
+			into PTB->PDOR, linked to channel 3 doing the same for
+			PTE->PDOR. Playing a colour costs no CPU time at all.
+
+			A colour is 24 bits (RGB()), gamma corrected through a
+			table. Fades are stepped once per period by the DMA
+			interrupt, which only rewrites the table words that
+			change, so a fade costs a few cycles every 5 ms.
+
+			The utils.h LED helpers must not be used after
+			RGB_Init(): the DMA rewrites the pins every tick. It
+			rewrites the rest of ports B and E as well, see
+			RGB_Init().
+*/
+
+#include <MK64F12.h>
+#include "rgb.h"
+#include "utils.h"
+#include "timebase.h"
+
+static const uint8_t gamma[256]= {  //perceived brightness to duty (gamma 2.2)
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+	  1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+	  3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+	  6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+	 12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+	 20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+	 30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+	 42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+	 56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+	 73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+	 91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+	113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+	137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+	163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+	192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+	223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
+//		global variables
+static uint32_t table_b[RGB_STEPS];  //PTB->PDOR value for each tick (red and blue)
+static uint32_t table_e[RGB_STEPS];  //PTE->PDOR value for each tick (green)
+static uint8_t duty[3];  //ticks each colour is on: red, green, blue
+static uint8_t current[3];  //colour being shown: red, green, blue
+
+static volatile uint32_t req_seq;  //odd while RGB_Fade() writes the request
+static volatile uint32_t req_colour;  //requested colour
+static volatile unsigned int req_steps;  //requested fade length in periods
+static uint32_t seen_seq;  //req_seq of request being faded to
+
+static uint8_t from[3];  //colour fade started from
+static uint8_t to[3];  //colour fade ends at
+static unsigned int step;  //periods of fade done
+static unsigned int steps;  //periods in fade
+
+
+/*
+		Helper function that changes the duty of one colour by
+		rewriting only the ticks between the old and new duty.
+		The LED is active low: a cleared bit is on.
+*/
+static void set_duty(int c, uint8_t new_duty) {
+	uint32_t *table= (c == 1) ? table_e : table_b;
+	uint32_t bit= (c == 0) ? 1 << LED_RED_PIN : (c == 1) ? 1 << LED_GREEN_PIN : 1 << LED_BLUE_PIN;
+	unsigned int i;
+
+	for (i= duty[c]; i<new_duty; i++) table[i] &= ~bit;  //on for longer
+	for (i= new_duty; i<duty[c]; i++) table[i] |= bit;  //on for shorter
+	duty[c]= new_duty;
+}
+
+
+/*
+		Helper function that sets the PIT2 tick for the current
+		bus clock. Called again by Clock_SetProfile() whenever
+		the bus clock changes.
+*/
+static void set_rate(void) {
+	PIT->CHANNEL[2].LDVAL = Clock_Bus()/(RGB_HZ*RGB_STEPS) - 1;  //one tick
+}
+
+
+/*
+		Function that starts the PWM engine with the LED off.
+*/
+void RGB_Init(void) {
+	for (int i= 0; i<RGB_STEPS; i++) {  //all colours off
+		table_b[i]= 1 << LED_RED_PIN | 1 << LED_BLUE_PIN;
+		table_e[i]= 1 << LED_GREEN_PIN;
+	}
+
+	SIM->SCGC6 |= (1 << 1) | SIM_SCGC6_PIT_MASK;  // Enable Clock to DMAMUX and PIT
+	SIM->SCGC7 |= (1 << 1);  // Enable Clock to DMA
+
+	/*
+		The channels below write whole words to PTB->PDOR and
+		PTE->PDOR, so every other output pin on ports B and E is
+		driven low each tick. Today no other pin on them is
+		an output (port B has only buttons and the microphone,
+		port E nothing else), and new outputs must go on
+		another port. Input pins ignore PDOR.
+	*/
+	DMA0->TCD[2].SADDR = (uint32_t) table_b;  //red and blue
+	DMA0->TCD[2].SOFF = 4;
+	DMA0->TCD[2].ATTR = (2 << 8 | 2);  //32-bit reads and writes
+	DMA0->TCD[2].NBYTES_MLNO = 4;  //one word per tick
+	DMA0->TCD[2].SLAST = -RGB_STEPS*4;  //back to start of table
+	DMA0->TCD[2].DADDR = (uint32_t) &PTB->PDOR;
+	DMA0->TCD[2].DOFF = 0;
+	DMA0->TCD[2].DLAST_SGA = 0;
+	DMA0->TCD[2].CITER_ELINKYES = (1 << 15 | 3 << 9 | RGB_STEPS);  //start channel 3 after every tick
+	DMA0->TCD[2].BITER_ELINKYES = (1 << 15 | 3 << 9 | RGB_STEPS);
+	DMA0->TCD[2].CSR = (3 << 8 | 1 << 5 | 1 << 1);  //link channel 3 at end of period too, interrupt
+
+	DMA0->TCD[3].SADDR = (uint32_t) table_e;  //green
+	DMA0->TCD[3].SOFF = 4;
+	DMA0->TCD[3].ATTR = (2 << 8 | 2);
+	DMA0->TCD[3].NBYTES_MLNO = 4;
+	DMA0->TCD[3].SLAST = -RGB_STEPS*4;
+	DMA0->TCD[3].DADDR = (uint32_t) &PTE->PDOR;
+	DMA0->TCD[3].DOFF = 0;
+	DMA0->TCD[3].DLAST_SGA = 0;
+	DMA0->TCD[3].CITER_ELINKNO = RGB_STEPS;
+	DMA0->TCD[3].BITER_ELINKNO = RGB_STEPS;
+	DMA0->TCD[3].CSR = 0;  //started only by channel 2
+
+	DMAMUX->CHCFG[2] = (1 << 7 | 1 << 6 | 60);  //always-on source, paced by PIT2
+	NVIC_EnableIRQ(DMA2_IRQn);
+	DMA0->SERQ = 2;  //enable channel 2 requests
+
+	PIT->MCR = (0 << 1);  // enable clock to PIT timers
+	set_rate();
+	PIT->CHANNEL[2].TCTRL = 0x1;  //start timer- triggers DMA, no interrupt
+	Clock_OnChange(set_rate);
+}
+
+
+/*
+		Function that fades the LED to colour over ms
+		milliseconds. The fade starts at the next period from
+		whatever colour is showing then.
+*/
+void RGB_Fade(uint32_t colour, unsigned int ms) {
+	unsigned int n= ms*RGB_HZ/1000;  //periods in fade
+
+	req_seq++;  //request being written
+	req_colour= colour;
+	req_steps= (n > 0) ? n : 1;
+	req_seq++;  //request consistent
+}
+
+
+/*
+		Function that changes the LED to colour at the next
+		period.
+*/
+void RGB_Set(uint32_t colour) {
+	RGB_Fade(colour, 0);
+}
+
+
+/*
+		DMA2 Interrupt Handler, called at the end of every PWM
+		period. Takes a new request from RGB_Fade() if there is
+		one and moves the fade one step.
+*/
+void DMA2_IRQHandler(void) {
+	uint32_t seq= req_seq;
+	int c;
+
+	DMA0->CINT = 2;  //clear interrupt
+
+	if (seq != seen_seq && !(seq & 1)) {  //new request, not half written
+		for (c= 0; c<3; c++) {
+			from[c]= current[c];
+			to[c]= (uint8_t) (req_colour >> (16 - 8*c));
+		}
+		steps= req_steps;
+		step= 0;
+		seen_seq= seq;
+	}
+
+	if (step == steps) return;  //no fade in progress
+	step++;
+	for (c= 0; c<3; c++) {  //interpolate in perceived brightness, then gamma correct
+		current[c]= (uint8_t) (from[c] + ((int) to[c] - from[c])*(int) step/(int) steps);
+		set_duty(c, gamma[current[c]]);
+	}
+}
@@ -0,0 +1,15 @@
+#ifndef __RGB_H__
+#define __RGB_H__
+
+#include <stdint.h>
+
+#define RGB_HZ 200  //PWM periods per second
+#define RGB_STEPS 256  //brightness steps per period
+
+#define RGB(r, g, b) ((uint32_t) (r) << 16 | (uint32_t) (g) << 8 | (uint32_t) (b))  //24-bit colour
+
+void RGB_Init(void);
+void RGB_Set(uint32_t colour);
+void RGB_Fade(uint32_t colour, unsigned int ms);
+
+#endif
@@ -0,0 +1,299 @@
+/*		This file contains the parts of the program that record
+			and play back an LED pattern without touching any
+			hardware. Time is passed in by the caller and LEDs are
+			changed through led_set(), so the same code runs on the
+			board (patterns.c) and in the simulator (sim/sim.c).
+			Recording, loading and edits build new patterns and
+			publish them through swap.c; playback only ever reads
+			published patterns, so it can switch between them
+			while playing without a glitch.
+*/
+
+#include <stdlib.h>
+#include "sequence.h"
+#include "swap.h"
+#include "events.h"
+
+//		global variables
+int max_num= 45;  //maximum number of LED presses allowed
+
+static unsigned int last_time;  //time in ms of last LED action
+static int press_num;  //number of buttons pressed
+static int pressed_prev[6];  //previous state of each button, indexed by LED number
+static int recording;  //1 between record_start() and record_finish()
+
+static pattern_event *recorded[2];  //recording buffers- one can play while the other records
+static int recorded_size[2];  //events each buffer can hold
+static int rec;  //buffer being recorded into
+static int rec_count;  //events recorded
+
+static int pos;  //index of next event to play
+static int at_start= 1;  //1 if pos is the start of a loop
+
+
+/*
+		Helper function that appends an event to the recording,
+		growing the buffer as needed. The buffer is not shared
+		until record_finish(), so it may move. Returns 1 if
+		successful and 0 if unsuccessful.
+*/
+static int append(int action, int num, unsigned int delay) {
+	if (rec_count == recorded_size[rec]) {  //buffer full
+		int size= recorded_size[rec] ? 2*recorded_size[rec] : 16;
+		pattern_event *grown= realloc(recorded[rec], size*sizeof(pattern_event));
+		if (grown == NULL) return 0; //allocation failed
+		recorded[rec]= grown;
+		recorded_size[rec]= size;
+	}
+
+	recorded[rec][rec_count].delay= delay;  //us since last LED action
+	recorded[rec][rec_count].action= action;  //on or off
+	recorded[rec][rec_count].num= num;  //LED number
+	rec_count++;
+
+	return 1;  //append successful
+}
+
+
+/*
+		Function that starts a new recording at time now (ms).
+		Records into whichever buffer is not playing. Returns 1
+		if successful and 0 if both buffers are still playing.
+*/
+int record_start(unsigned int now) {
+	if (recorded[rec] != NULL && pattern_busy(recorded[rec])) rec= !rec;  //try the other buffer
+	if (recorded[rec] != NULL && pattern_busy(recorded[rec])) return 0;
+
+	rec_count= 0;
+	recording= 1;
+	last_time= now;
+	press_num= 0;
+	for (int num= 1; num<=5; num++) pressed_prev[num]= 0;  //initially no buttons have been pressed
+	return 1;
+}
+
+
+/*
+		Function that records the state of one button at time
+		now (ms) without touching the LED. Compares the state
+		with the previous one to detect a press or release and
+		appends it to the recording. Returns 1 if a press or
+		release was recorded, 0 if nothing changed, and -1 if
+		the recording could not be extended. A gap longer than
+		a delay can hold (about 71 minutes) is recorded as the
+		longest delay instead of wrapping to a short one.
+*/
+int record_edge(int num, int pressed, unsigned int now) {
+	int was_pressed= pressed_prev[num];
+	unsigned int gap;  //time in ms since last LED action
+	pressed_prev[num]= pressed;
+
+	if (!recording || press_num >= max_num || pressed == was_pressed) return 0;  //not recording, full or no change
+
+	gap= now - last_time;
+	if (!append(pressed, num, (gap > 0xFFFFFFFF/1000) ? 0xFFFFFFFF : gap*1000)) return -1;  //longest delay after 71 minutes
+	last_time= now;  //measure next press from here
+	if (!pressed) press_num++;  //count button press on release
+
+	return 1;
+}
+
+
+/*
+		Function that records the state of one button like
+		record_edge() and mirrors a recorded press or release
+		on the LED.
+*/
+int record_button(int num, int pressed, unsigned int now) {
+	int result= record_edge(num, pressed, now);
+
+	if (result > 0) led_set(num, pressed);
+	return result;
+}
+
+
+/*
+		Function that returns 1 once the maximum number of
+		presses has been recorded.
+*/
+int record_full(void) {
+	return press_num == max_num;
+}
+
+
+/*
+		Function that ends the recording and publishes it as
+		the new pattern, which playback starts at its next loop.
+		Returns the number of events recorded (0 if none, and
+		nothing is published).
+*/
+int record_finish(void) {
+	recording= 0;
+	if (rec_count == 0) return 0;
+
+	load_pattern(recorded[rec], rec_count);
+	return rec_count;
+}
+
+
+/*
+		Function that publishes count events made offline as
+		the new pattern at recorded speed, e.g. baked_pattern.
+		The events are played in place, so they must not change
+		while pattern_busy() says they are playing. Returns 1 if
+		successful and 0 if there are no events.
+*/
+int load_pattern(const pattern_event *events, int count) {
+	pattern *next;
+
+	if (count <= 0) return 0;
+
+	next= pattern_edit();
+	next->events= events;
+	next->count= count;
+	next->scale= PATTERN_SCALE_ONE;
+	next->direction= 1;
+	pattern_publish(1);  //new events: switch at a loop boundary
+
+	return 1;
+}
+
+
+/*
+		Helper function that returns scale after one speed
+		edit: faster if speed is 1 and slower if speed is 0.
+*/
+static unsigned int scaled(unsigned int scale, int speed) {
+	unsigned long long next= (speed) ? (unsigned long long) scale*3/4 : (unsigned long long) scale*5/4;
+
+	if (next == 0) next= 1;
+	if (next > PATTERN_SCALE_MAX) next= PATTERN_SCALE_MAX;
+	return (unsigned int) next;
+}
+
+
+/*
+		Function that scales the delay of every event in the
+		pattern. Speeds up the pattern if speed is 1 and slows
+		it down if speed is 0.
+*/
+void change_speed(int speed) {
+	pattern *next= pattern_edit();
+
+	next->scale= scaled(next->scale, speed);  //modify speed
+	pattern_publish(0);
+}
+
+
+/*
+		Function that reverses the direction of the pattern.
+*/
+void reverse(void) {
+	pattern *next= pattern_edit();
+
+	next->direction= !next->direction;  //change traversal direction
+	pattern_publish(0);
+}
+
+
+/*
+		Function that stores the scale and direction of the
+		newest published pattern in scale and direction.
+*/
+void get_play_state(unsigned int *scale, int *direction) {
+	const pattern *p= pattern_edit();  //copy of the newest pattern, not published
+
+	*scale= p->scale;
+	*direction= p->direction;
+}
+
+
+/*
+		Function that publishes the newest pattern with the
+		given scale and direction, which playback takes at its
+		next action.
+*/
+void set_play_state(unsigned int scale, int direction) {
+	pattern *next= pattern_edit();
+
+	next->scale= scale;
+	next->direction= direction;
+	pattern_publish(0);
+}
+
+
+/*
+		Function that applies every event posted by the button
+		interrupt handlers since it was last called to scale
+		and direction, without publishing them. Handlers post
+		every rising edge, so an event that follows the last one
+		of its type by less than debounce (in the units the
+		handlers timestamp with) is contact bounce and is
+		dropped. Returns the number of events applied.
+*/
+int take_edits(unsigned int *scale, int *direction, uint32_t debounce) {
+	static uint32_t last[4];  //time of last accepted event of each type
+	static int seen[4];  //1 once an event of that type has been accepted
+	event_type event;
+	uint32_t time;
+	int count= 0;
+
+	while ((event= event_get(&time)) != EVENT_NONE) {
+		if (seen[event] && time - last[event] < debounce) continue;  //bounce
+		seen[event]= 1;
+		last[event]= time;
+		count++;
+
+		if (event == EVENT_SPEED_UP) *scale= scaled(*scale, 1);
+		else if (event == EVENT_SLOW_DOWN) *scale= scaled(*scale, 0);
+		else if (event == EVENT_REVERSE) *direction= !*direction;
+	}
+
+	return count;
+}
+
+
+/*
+		Function that makes the next action the first one of
+		the pattern, as at the start of a loop.
+*/
+void play_restart(void) {
+	pos= 0;
+	at_start= 1;
+}
+
+
+/*
+		Function that processes the current action of the
+		newest published pattern and moves to the next one in
+		the current direction. Stores the time in us to wait
+		before the next action in wait. Returns 1 if the next
+		action starts a new loop of the pattern and 0 otherwise.
+*/
+int play_step(unsigned int *wait) {
+	const pattern *p= pattern_take(at_start);
+	const pattern_event *event;
+	unsigned long long delay;
+
+	if (p->count == 0) {  //nothing published yet
+		*wait= 0;
+		return 1;
+	}
+
+	event= &p->events[pos];
+	led_set(event->num, p->direction ? event->action : !event->action);  //reverse traversal reverses actions
+
+	if (p->direction) {  //traverse normally
+		pos= (pos + 1 == p->count) ? 0 : pos + 1;  //get next action
+		delay= p->events[pos].delay;  //delay belongs to the action it precedes
+	} else {  //traverse in reverse- must get the delay and next action in opposite order
+		delay= event->delay;
+		pos= (pos == 0) ? p->count - 1 : pos - 1;  //get previous action
+	}
+
+	delay= delay*p->scale >> 16;
+	*wait= (delay > 0xFFFFFFFF) ? 0xFFFFFFFF : (unsigned int) delay;
+	at_start= (pos == 0);
+
+	return at_start;
+}
@@ -0,0 +1,44 @@
+#ifndef __SEQUENCE_H__
+#define __SEQUENCE_H__
+
+#include <stdint.h>
+
+typedef struct {  //one event of a pattern: turn an LED on or off
+	unsigned int delay;  //time in us since previous event
+	unsigned char num;  //1 (white), 2 (yellow), 3 (red), 4 (blue), or 5 (green)
+	unsigned char action;  //1 (turn LED on) or 0 (turn LED off)
+} pattern_event;
+
+typedef struct {  //one pattern ready to play- never changed once published (see swap.c)
+	const pattern_event *events;  //events in recorded order
+	int count;  //number of events
+	unsigned int scale;  //delay multiplier, PATTERN_SCALE_ONE plays them as recorded
+	int direction;  //1 (normal) or 0 (reverse)
+} pattern;
+
+#define PATTERN_SCALE_ONE 0x10000  //pattern.scale for recorded speed
+#define PATTERN_SCALE_MAX 0x7FFFFFFF  //slowest pattern.scale- leaves a bit free in sync frames
+#define PATTERN_RECORD_SIZE 6  //bytes per event in a raw pattern file: delay (4, little endian), num, action
+
+extern int max_num;  //maximum number of LED presses allowed
+
+extern const pattern_event baked_pattern[];  //pattern compiled into the program, if any
+extern const int baked_pattern_len;
+
+void led_set(int num, int on);  //provided by the firmware or the simulator
+
+int record_start(unsigned int now);
+int record_edge(int num, int pressed, unsigned int now);
+int record_button(int num, int pressed, unsigned int now);
+int record_full(void);
+int record_finish(void);
+int load_pattern(const pattern_event *events, int count);
+void change_speed(int speed);
+void reverse(void);
+void get_play_state(unsigned int *scale, int *direction);
+void set_play_state(unsigned int scale, int direction);
+int take_edits(unsigned int *scale, int *direction, uint32_t debounce);
+void play_restart(void);
+int play_step(unsigned int *wait);
+
+#endif
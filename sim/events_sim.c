@@ -0,0 +1,126 @@
+/*		This file contains a host stress test for the event
+			queue in events.c. Several producer threads stand in
+			for button interrupt handlers and post as fast as they
+			can (retrying while the queue is full), while the main
+			thread reads events the way display() does. Every
+			event carries its producer and a sequence number in
+			its time, and the reader checks that:
+
+				- each producer's events arrive in order with none
+				  missing and none repeated
+				- the type matches the producer (no torn slot)
+				- every event posted is read exactly once, and none
+				  is left behind once the producers have finished
+
+			Build on the host (not part of the board project):
+				cc -std=c99 -O2 -pthread -I.. -o events_sim events_sim.c ../events.c
+
+			Usage:
+				events_sim [events_per_producer]
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "events.h"
+
+#define PRODUCERS 4  //threads posting at once
+#define SEQ_MASK 0xFFFFFF  //low bits of time hold the sequence number
+#define MAX_RETRIES 1000000  //refusals in a row before the queue counts as stuck
+
+//		global variables
+static unsigned long per_producer= 200000;  //events each producer posts
+static unsigned long full[PRODUCERS];  //posts refused because the queue was full
+static unsigned int finished;  //producers that have posted everything
+static unsigned int stuck;  //producers that gave up on a queue that stayed full
+
+
+/*
+		Helper function that returns the event type a producer
+		posts, so the reader can spot a type and time that came
+		from different posts.
+*/
+static event_type type_of(unsigned int producer) {
+	return (event_type) (EVENT_SPEED_UP + producer % 3);
+}
+
+
+/*
+		Function for a producer thread. Each event's time holds
+		the producer in the top byte and its sequence number in
+		the rest.
+*/
+static void *produce(void *arg) {
+	unsigned int producer= (unsigned int) (size_t) arg;
+	unsigned int seed= producer + 1;
+	unsigned long seq, retries;
+
+	for (seq= 0; seq<per_producer; seq++) {
+		uint32_t time= producer << 24 | (uint32_t) (seq & SEQ_MASK);
+
+		for (retries= 0; !event_post(type_of(producer), time); retries++) {  //full- wait for the reader
+			if (retries == MAX_RETRIES) {  //reader can never free a slot
+				__atomic_add_fetch(&stuck, 1, __ATOMIC_RELAXED);
+				seq= per_producer;
+				break;
+			}
+			full[producer]++;
+			sched_yield();
+		}
+		if (rand_r(&seed) % 64 == 0) sched_yield();  //switch threads often on one CPU
+	}
+	__atomic_add_fetch(&finished, 1, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+
+int main(int argc, char **argv) {
+	pthread_t threads[PRODUCERS];
+	unsigned long received[PRODUCERS]= {0};  //events read from each producer
+	unsigned long total= 0, failures= 0, refused= 0;
+	unsigned int i;
+
+	if (argc > 2 || (argc == 2 && (per_producer= strtoul(argv[1], NULL, 10)) == 0)) {
+		fprintf(stderr, "usage: %s [events_per_producer]\n", argv[0]);
+		return 2;
+	}
+
+	for (i= 0; i<PRODUCERS; i++) pthread_create(&threads[i], NULL, produce, (void *) (size_t) i);
+
+	while (1) {
+		int all_done= __atomic_load_n(&finished, __ATOMIC_ACQUIRE) == PRODUCERS;
+		uint32_t time;
+		event_type type= event_get(&time);
+		unsigned int producer= time >> 24;
+
+		if (type == EVENT_NONE) {
+			if (all_done) break;  //everything published has been read
+			sched_yield();  //let the producers run
+			continue;
+		}
+		total++;
+		if (producer >= PRODUCERS || type != type_of(producer)
+		    || (time & SEQ_MASK) != (received[producer] & SEQ_MASK)) {  //torn, lost or repeated
+			if (failures++ < 10) printf("bad event: type %d time %08x\n", type, (unsigned int) time);
+			continue;
+		}
+		received[producer]++;
+	}
+
+	for (i= 0; i<PRODUCERS; i++) {
+		pthread_join(threads[i], NULL);
+		refused+= full[i];
+		if (received[i] != per_producer) {  //events lost or never posted
+			printf("producer %u: %lu of %lu events read\n", i, received[i], per_producer);
+			failures++;
+		}
+	}
+
+	if (stuck) printf("%u producers found the queue stuck full\n", stuck);
+	printf("%lu events from %d producers, %lu posts retried while full, %lu failures\n",
+	       total, PRODUCERS, refused, failures);
+	return failures != 0;
+}
@@ -0,0 +1,245 @@
+/*		This file contains a discrete-event simulator that runs
+			the real recorder and playback code (sequence.c, swap.c,
+			events.c and lockstep.c) on a PC against a virtual
+			clock. It reads a scripted button trace, records the
+			pattern the same way pattern_input() does, then plays it
+			back for a given amount of virtual time while posting
+			the speed and reverse events the button interrupts
+			would. Playback runs through lockstep.c as a leader
+			with no followers, like display(), so an edit applies
+			at the first action LOCKSTEP_LEAD or more after its
+			press. Every LED change is printed as "time_us led
+			on|off", so hours of playback take milliseconds and
+			timing regressions show up as a diff against a golden
+			timeline.
+
+			Build on the host (not part of the board project):
+				cc -std=c99 -O2 -I.. -o sim sim.c ../sequence.c ../swap.c ../events.c \
+					../sync.c ../lockstep.c
+
+			Usage:
+				sim <trace> <duration_ms> [golden]
+
+			With a golden timeline the output is compared instead of
+			printed, and the exit status is 1 on the first mismatch.
+			check.sh runs example.txt for 8000000 ms (over two
+			hours, so the pattern loops across its long gap)
+			against example.golden.
+
+			Trace format, one input change per line ('#' starts a
+			comment):
+				<time_ms> <white|yellow|red|blue|green|start> <0|1>
+			Recording ends when start is pressed (the modify() stage
+			is skipped) or the press limit is reached. After that,
+			presses of white, red and green post EVENT_REVERSE,
+			EVENT_SPEED_UP and EVENT_SLOW_DOWN as on the board.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sequence.h"
+#include "events.h"
+#include "lockstep.h"
+
+#define MAX_INPUTS 4096  //maximum number of lines in a trace
+#define DEBOUNCE_MS 10  //as patterns.c- presses closer than this to the last one are bounce
+
+struct input {  //struct representing one line of the trace
+	unsigned int time;  //time in ms
+	int num;  //LED number (1 to 5) or 0 for start button
+	int pressed;  //1 (pressed) or 0 (released)
+};
+
+//		global variables
+static struct input inputs[MAX_INPUTS];  //parsed trace
+static int num_inputs;  //number of lines in trace
+static unsigned long long now_us;  //virtual time in us
+static FILE *golden;  //golden timeline or NULL to print
+static long line_num;  //number of timeline lines produced
+static int mismatch;  //1 once output differs from golden
+
+static const char *names[6]= {"start", "white", "yellow", "red", "blue", "green"};
+
+
+/*
+		Function that the recorder and playback code call to
+		change an LED. Prints or checks one timeline line.
+*/
+void led_set(int num, int on) {
+	char line[64];  //generated line
+	char expected[64];  //golden line
+
+	snprintf(line, sizeof(line), "%llu %s %s\n", now_us, names[num], on ? "on" : "off");
+	line_num++;
+
+	if (golden == NULL) {  //print timeline
+		fputs(line, stdout);
+		return;
+	}
+
+	if (mismatch) return;  //only report the first difference
+	if (fgets(expected, sizeof(expected), golden) == NULL) strcpy(expected, "<end of golden>\n");
+	if (strcmp(line, expected)) {
+		printf("mismatch at line %ld\n  expected: %s  got:      %s", line_num, expected, line);
+		mismatch= 1;
+	}
+}
+
+
+/*
+		Helper function that converts an input name to an LED
+		number. Returns -1 if the name is unknown.
+*/
+static int input_num(const char *name) {
+	for (int num= 0; num<=5; num++) {
+		if (!strcmp(name, names[num])) return num;
+	}
+	return -1;
+}
+
+
+/*
+		Helper function that reads a trace file into inputs.
+		Returns 1 if successful and 0 if unsuccessful.
+*/
+static int load_trace(const char *path) {
+	FILE *f= fopen(path, "r");
+	char line[128];
+	char name[16];
+	unsigned int time;
+	int pressed;
+	int line_no= 0;
+
+	if (f == NULL) {
+		perror(path);
+		return 0;
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		line_no++;
+		char *comment= strchr(line, '#');
+		if (comment != NULL) *comment= '\0';  //ignore comments
+		if (sscanf(line, " %15s", name) != 1) continue;  //blank line
+
+		if (sscanf(line, "%u %15s %d", &time, name, &pressed) != 3 || input_num(name) < 0 || num_inputs == MAX_INPUTS) {
+			fprintf(stderr, "%s:%d: bad trace line\n", path, line_no);
+			fclose(f);
+			return 0;
+		}
+		inputs[num_inputs].time= time;
+		inputs[num_inputs].num= input_num(name);
+		inputs[num_inputs].pressed= pressed ? 1 : 0;
+		num_inputs++;
+	}
+
+	fclose(f);
+	return 1;
+}
+
+
+/*
+		Helper function that feeds the trace to the recorder
+		until start is pressed or the press limit is reached.
+		Returns the index of the first input after recording.
+*/
+static int record(void) {
+	int i;
+
+	record_start(0);
+	for (i= 0; i<num_inputs; i++) {
+		now_us= (unsigned long long) inputs[i].time*1000;
+		if (inputs[i].num == 0) {  //start button ends recording
+			if (inputs[i].pressed) return i + 1;
+			continue;
+		}
+		if (record_button(inputs[i].num, inputs[i].pressed, inputs[i].time) < 0) {
+			fprintf(stderr, "out of memory\n");
+			exit(2);
+		}
+		if (record_full()) return i + 1;  //press limit reached
+	}
+
+	return i;
+}
+
+
+/*
+		Helper function that posts the event a button interrupt
+		would for a press during playback.
+*/
+static void post_input(const struct input *in) {
+	if (!in->pressed) return;  //interrupts are on the rising edge only
+	if (in->num == 1) event_post(EVENT_REVERSE, in->time);
+	else if (in->num == 3) event_post(EVENT_SPEED_UP, in->time);
+	else if (in->num == 5) event_post(EVENT_SLOW_DOWN, in->time);
+}
+
+
+/*
+		Helper function that plays the pattern until end_us the
+		way display() does, posting events from the trace at
+		their virtual time and handing them to lockstep.c.
+		Returns 1 if successful and 0 if the pattern never
+		advances time.
+*/
+static int play(int next, unsigned long long end_us) {
+	int stalled= 0;  //actions in a row that took no time
+
+	lockstep_begin(1, now_us, play_step, play_restart);
+	while (lockstep_next() < end_us) {
+		if (next < num_inputs && (unsigned long long) inputs[next].time*1000 <= lockstep_next()) {
+			if (now_us < (unsigned long long) inputs[next].time*1000) now_us= (unsigned long long) inputs[next].time*1000;
+			post_input(&inputs[next++]);  //as the interrupt would
+		}
+		else {
+			now_us= lockstep_next();
+			lockstep_step();
+			if (lockstep_next() != now_us) stalled= 0;
+			else if (++stalled > 2*max_num) return 0;  //whole pattern takes no time
+		}
+		lockstep_edits(now_us, DEBOUNCE_MS);
+	}
+
+	return 1;
+}
+
+
+int main(int argc, char **argv) {
+	unsigned long long end_us;  //end of simulation in us
+	int next;  //first input after recording
+
+	if (argc < 3 || argc > 4) {
+		fprintf(stderr, "usage: %s <trace> <duration_ms> [golden]\n", argv[0]);
+		return 2;
+	}
+	if (!load_trace(argv[1])) return 2;
+	if (argc == 4 && (golden= fopen(argv[3], "r")) == NULL) {
+		perror(argv[3]);
+		return 2;
+	}
+
+	next= record();
+	if (!record_finish()) {
+		fprintf(stderr, "trace records no presses\n");
+		return 2;
+	}
+
+	end_us= now_us + strtoull(argv[2], NULL, 10)*1000;
+	if (!play(next, end_us)) {
+		fprintf(stderr, "pattern has zero length\n");
+		return 2;
+	}
+
+	if (golden != NULL) {  //golden must not have extra lines
+		char extra[64];
+		if (!mismatch && fgets(extra, sizeof(extra), golden) != NULL) {
+			printf("mismatch at line %ld\n  expected: %s  got:      <end of output>\n", line_num + 1, extra);
+			mismatch= 1;
+		}
+		if (!mismatch) printf("%ld lines match\n", line_num);
+		fclose(golden);
+	}
+
+	return mismatch;
+}
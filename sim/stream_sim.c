@@ -0,0 +1,203 @@
+/*		This file contains a host stand-in for streaming
+			playback (stream.c). The storage is a regular file of
+			raw records (tools/midi2pattern -f raw) and every block
+			read takes a chosen amount of virtual time, so slow
+			storage shows up as counted stalls and late LED
+			changes. As in sim.c, every LED change is printed as
+			"time_us led on|off" or compared against a golden
+			timeline, and actions are scheduled on absolute time
+			the way display() does, so a stall delays only the
+			actions that were waiting for it.
+
+			Build on the host (not part of the board project):
+				cc -std=c99 -O2 -I.. -o stream_sim stream_sim.c ../stream.c ../sequence.c ../swap.c ../events.c
+
+			Usage:
+				stream_sim [-r read_us | -m] [-c count] <pattern.raw> <duration_ms> [golden]
+
+			-r sets the virtual time one block read takes (default
+			2000 us, SPI flash at about 2 MHz). -m loads the whole
+			file into RAM with load_pattern() and plays it with
+			play_step() instead, giving the reference timeline a
+			streamed run must match when it does not stall. -c
+			keeps only the first count events of the file, so one
+			file tests patterns of any length up to its own.
+
+			Example, checking that a pattern filling exactly two
+			blocks loops without a stall:
+				./stream_sim -m -c 170 stream.raw 20000 > ref.txt
+				./stream_sim -c 170 stream.raw 20000 ref.txt
+*/
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stream.h"
+
+//		global variables
+static FILE *storage;  //pattern file
+static unsigned long storage_end= ULONG_MAX;  //bytes of the file that hold the pattern
+static unsigned long long now_us;  //virtual time in us
+static unsigned long long ready_us;  //virtual time the block being read is ready
+static unsigned int read_us= 2000;  //virtual time one block read takes
+static unsigned long reads;  //number of blocks read
+static int polls;  //busy answers since the last action started
+static FILE *golden;  //golden timeline or NULL to print
+static long line_num;  //number of timeline lines produced
+static int mismatch;  //1 once output differs from golden
+
+static const char *names[6]= {"start", "white", "yellow", "red", "blue", "green"};
+
+
+/*
+		Function that stream.c calls to start a block read. The
+		data is copied at once but only counts as read once
+		read_us of virtual time has passed. Storage past the end
+		of the pattern reads as erased flash (0xFF).
+*/
+void storage_read(uint32_t address, uint8_t *buf, unsigned int len) {
+	size_t got= 0;
+	size_t want= (address >= storage_end) ? 0 : (storage_end - address < len) ? storage_end - address : len;
+
+	if (fseek(storage, address, SEEK_SET) == 0) got= fread(buf, 1, want, storage);
+	memset(buf + got, 0xFF, len - got);
+	ready_us= now_us + read_us;
+	reads++;
+}
+
+
+/*
+		Function that stream.c calls to check a block read. The
+		first busy answer in an action is a check that takes no
+		time; asking again means stream.c is waiting, so virtual
+		time moves to the moment the read finishes, as
+		busy-waiting on the board would.
+*/
+int storage_busy(void) {
+	if (now_us >= ready_us) return 0;
+	if (polls++ == 0) return 1;
+	now_us= ready_us;
+	return 1;
+}
+
+
+/*
+		Function that playback calls to change an LED. Prints or
+		checks one timeline line.
+*/
+void led_set(int num, int on) {
+	char line[64];  //generated line
+	char expected[64];  //golden line
+
+	snprintf(line, sizeof(line), "%llu %s %s\n", now_us, names[num], on ? "on" : "off");
+	line_num++;
+
+	if (golden == NULL) {  //print timeline
+		fputs(line, stdout);
+		return;
+	}
+
+	if (mismatch) return;  //only report the first difference
+	if (fgets(expected, sizeof(expected), golden) == NULL) strcpy(expected, "<end of golden>\n");
+	if (strcmp(line, expected)) {
+		printf("mismatch at line %ld\n  expected: %s  got:      %s", line_num, expected, line);
+		mismatch= 1;
+	}
+}
+
+
+/*
+		Helper function that loads the whole pattern file into
+		RAM and publishes it. Returns 1 if successful and 0 if
+		unsuccessful.
+*/
+static int load_file(void) {
+	uint8_t rec[PATTERN_RECORD_SIZE];
+	pattern_event *events= NULL;
+	int count= 0;
+	int size= 0;
+
+	rewind(storage);
+	while ((unsigned long) count*sizeof(rec) < storage_end
+	       && fread(rec, 1, sizeof(rec), storage) == sizeof(rec) && rec[4] >= 1 && rec[4] <= 5) {
+		if (count == size) {
+			size= size ? 2*size : 1024;
+			if ((events= realloc(events, size*sizeof(pattern_event))) == NULL) return 0;
+		}
+		events[count].delay= (unsigned int) rec[0] | (unsigned int) rec[1] << 8 | (unsigned int) rec[2] << 16 | (unsigned int) rec[3] << 24;
+		events[count].num= rec[4];
+		events[count].action= rec[5];
+		count++;
+	}
+
+	return load_pattern(events, count);
+}
+
+
+int main(int argc, char **argv) {
+	int arg;
+	int memory= 0;  //1 to play from RAM instead of streaming
+	unsigned long long end_us;  //end of simulation in us
+	unsigned long long next= 0;  //time of next action in us
+	unsigned int wait;  //time until next action in us
+	int zero= 0;  //actions in a row that took no time
+
+	for (arg= 1; arg<argc && argv[arg][0] == '-'; arg++) {
+		if (!strcmp(argv[arg], "-m")) memory= 1;
+		else if (!strcmp(argv[arg], "-r") && arg + 1 < argc) read_us= (unsigned int) strtoul(argv[++arg], NULL, 10);
+		else if (!strcmp(argv[arg], "-c") && arg + 1 < argc) storage_end= strtoul(argv[++arg], NULL, 10)*PATTERN_RECORD_SIZE;
+		else break;
+	}
+	if (argc - arg < 2 || argc - arg > 3) {
+		fprintf(stderr, "usage: %s [-r read_us | -m] [-c count] <pattern.raw> <duration_ms> [golden]\n", argv[0]);
+		return 2;
+	}
+	if ((storage= fopen(argv[arg], "rb")) == NULL) {
+		perror(argv[arg]);
+		return 2;
+	}
+	if (argc - arg == 3 && (golden= fopen(argv[arg + 2], "r")) == NULL) {
+		perror(argv[arg + 2]);
+		return 2;
+	}
+
+	if (memory ? !load_file() : !stream_open(0)) {
+		fprintf(stderr, "pattern is empty\n");
+		return 2;
+	}
+	if (!memory) ready_us-= now_us;  //start playing once the first block is in
+	now_us= 0;
+	end_us= strtoull(argv[arg + 1], NULL, 10)*1000;
+
+	while (next < end_us) {
+		polls= 0;
+		if (memory) play_step(&wait);
+		else stream_step(&wait);
+		next+= wait;
+		if (now_us < next) now_us= next;  //late after a stall: catch up
+
+		if (wait) zero= 0;
+		else if (++zero > 1000000) {
+			fprintf(stderr, "pattern has zero length\n");
+			return 2;
+		}
+	}
+
+	if (golden != NULL) {  //golden must not have extra lines
+		char extra[64];
+		if (!mismatch && fgets(extra, sizeof(extra), golden) != NULL) {
+			printf("mismatch at line %ld\n  expected: %s  got:      <end of output>\n", line_num + 1, extra);
+			mismatch= 1;
+		}
+		if (!mismatch) printf("%ld lines match\n", line_num);
+		fclose(golden);
+	}
+	fclose(storage);
+
+	if (!memory) {
+		fprintf(stderr, "%lu blocks read, %lu stalls, window %d bytes\n",
+			reads, stream_stalls(), 2*STREAM_BLOCK);
+	}
+	return mismatch;
+}
@@ -0,0 +1,188 @@
+/*		This file contains a host stress test for the pattern
+			hand-over in swap.c. Two threads stand in for the main
+			loop and the playback context: the builder publishes
+			speed/reverse style edits and whole new patterns as
+			fast as it can (with short random pauses, as an
+			interrupt handler would be), reusing event arrays as soon as
+			pattern_busy() allows, while the player takes patterns
+			the way play_step() does and checks every one it gets:
+
+				- every event of the array belongs to the same
+				  generation and the count matches it (no array was
+				  rewritten while playing or published half built)
+				- scale and direction agree (no torn descriptor)
+				- a new array is only taken at the start of a loop
+
+			Build on the host (not part of the board project):
+				cc -std=c99 -O2 -pthread -I.. -o swap_sim swap_sim.c ../swap.c
+
+			Usage:
+				swap_sim [seconds]
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "swap.h"
+
+#define POOL 4  //event arrays the builder rotates through
+#define MAX_EVENTS 256  //events per array
+
+//		global variables
+static pattern_event pool[POOL][MAX_EVENTS];  //event arrays
+static volatile int done;  //1 once time is up
+static unsigned long edits, loads, takes, swaps;  //counts for the report
+static unsigned long failures;  //checks failed by the player
+static uint64_t publish_ns, take_ns;  //total time spent in each call
+
+
+/*
+		Helper function that returns the host clock in ns.
+*/
+static uint64_t host_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+
+/*
+		Helper function that publishes the spare descriptor and
+		adds the time it took to the total.
+*/
+static void publish(int restart) {
+	uint64_t start= host_ns();
+	pattern_publish(restart);
+	publish_ns+= host_ns() - start;
+}
+
+
+/*
+		Function for the builder thread. Edits keep scale odd
+		when playing normally and even in reverse, so the player
+		can spot a descriptor mixed from two edits. Every event
+		of a new array carries its generation in delay and the
+		count in num and action.
+*/
+static void *build(void *arg) {
+	unsigned int seed= 1;
+	unsigned int generation= 0;
+	(void) arg;
+
+	while (!done) {
+		pattern *next;
+
+		for (volatile int i= rand_r(&seed) % 256; i>0; i--);  //let the player run between publishes
+		if (rand_r(&seed) % 64 == 0) sched_yield();  //switch threads often on one CPU
+		if (rand_r(&seed) % 8) {  //edit: new speed and direction
+			next= pattern_edit();
+			next->direction= rand_r(&seed) & 1;
+			next->scale= (rand_r(&seed) << 1) | next->direction;
+			publish(0);
+			edits++;
+			continue;
+		}
+
+		int slot= -1;  //new pattern: find an array nobody plays
+		for (int i= 0; i<POOL && slot<0; i++) {
+			if (!pattern_busy(pool[i])) slot= i;
+		}
+		if (slot < 0) continue;  //all playing: try again later
+
+		int count= 1 + rand_r(&seed) % MAX_EVENTS;
+		generation++;
+		for (int i= 0; i<count; i++) {
+			pool[slot][i].delay= generation;
+			pool[slot][i].num= (unsigned char) count;
+			pool[slot][i].action= (unsigned char) (count >> 8);
+		}
+		next= pattern_edit();
+		next->events= pool[slot];
+		next->count= count;
+		publish(1);
+		loads++;
+	}
+
+	return NULL;
+}
+
+
+/*
+		Helper function that checks one pattern taken by the
+		player. Returns 1 if it is consistent and 0 if not.
+*/
+static int check(const pattern *p) {
+	if ((p->scale & 1) != (unsigned int) p->direction) return 0;  //torn descriptor
+	if (p->count == 0) return p->events == NULL;
+
+	unsigned int generation= p->events[0].delay;
+	int count= p->events[0].num | p->events[0].action << 8;
+	if (count != p->count) return 0;  //descriptor and array from different patterns
+	for (int i= 0; i<count; i++) {  //array rewritten while playing
+		if (p->events[i].delay != generation || (p->events[i].num | p->events[i].action << 8) != count) return 0;
+	}
+
+	return 1;
+}
+
+
+/*
+		Function for the player thread. Takes a pattern once
+		per action like play_step() and checks it.
+*/
+static void *play(void *arg) {
+	const pattern *last= NULL;  //pattern of previous action- given back, only compared
+	const pattern_event *last_events= NULL;  //its events, saved while it was still ours
+	int pos= 0;  //index of next action
+	unsigned int seed= 2;
+	(void) arg;
+
+	while (!done) {
+		uint64_t start= host_ns();
+		const pattern *p= pattern_take(pos == 0);
+		take_ns+= host_ns() - start;
+		takes++;
+
+		if (!check(p)) failures++;
+		if (last != NULL && p->events != last_events && pos != 0) failures++;  //new array mid-loop
+		if (p != last) swaps++;
+		last= p;
+		last_events= p->events;
+
+		if (p->count) pos= (pos + 1) % p->count;
+		if (rand_r(&seed) % 64 == 0) sched_yield();
+	}
+
+	return NULL;
+}
+
+
+int main(int argc, char **argv) {
+	unsigned int seconds= (argc > 1) ? (unsigned int) atoi(argv[1]) : 10;
+	pthread_t builder, player;
+	struct timespec ts= { seconds, 0 };
+
+	if (argc > 2) {
+		fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+		return 2;
+	}
+
+	pattern_edit()->scale= 1;  //start normal, odd scale
+	publish(0);
+
+	pthread_create(&builder, NULL, build, NULL);
+	pthread_create(&player, NULL, play, NULL);
+	nanosleep(&ts, NULL);
+	done= 1;
+	pthread_join(builder, NULL);
+	pthread_join(player, NULL);
+
+	printf("%lu edits and %lu new patterns published, %lu takes, %lu swaps, %lu failures\n",
+		edits, loads, takes, swaps, failures);
+	printf("%.0f ns per publish, %.0f ns per take on average\n",
+		(double) publish_ns/(edits + loads + 1), (double) take_ns/takes);
+	return failures != 0;
+}
@@ -0,0 +1,331 @@
+/*		This file contains a host stand-in for one board on the
+			serial sync link, for testing sync.c and lockstep.c
+			without hardware. Each process is one board: its local
+			clock is the host monotonic clock with a chosen drift
+			and offset, and the link is stdin (receive) and stdout
+			(transmit), so boards are connected with pipes or ptys.
+			Every board plays the same built-in pattern through
+			lockstep.c, and the leader presses random speed and
+			reverse buttons every second or so.
+
+			The leader's clock is the host clock itself, so every
+			follower can measure its true error. Followers print a
+			report to stderr every ten seconds.
+
+			Given a log file, a board writes every action it plays
+			as "time_us led on|off", where time_us is the time the
+			action was scheduled for on the leader's clock. The
+			compare mode checks that a follower's log, from the
+			first action it played, is exactly the leader's: same
+			actions at the same scheduled times, across every edit.
+
+			Build on the host (not part of the board project):
+				cc -std=c99 -O2 -I.. -o sync_sim sync_sim.c ../sync.c ../lockstep.c \
+					../sequence.c ../swap.c ../events.c
+
+			Usage:
+				sync_sim leader [seconds [log]]
+				sync_sim follower <drift_ppm> <offset_us> [log]
+				sync_sim compare <leader_log> <follower_log>
+
+			Example, one leader and two followers for an hour:
+				./sync_sim leader 3600 | tee >(./sync_sim follower 150 20000) \
+					| ./sync_sim follower -80 -3000
+
+			Example, checking that a follower plays in step:
+				./sync_sim leader 10 leader.log | ./sync_sim follower 150 20000 follower.log
+				./sync_sim compare leader.log follower.log
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include "sync.h"
+#include "lockstep.h"
+#include "sequence.h"
+#include "events.h"
+
+#define REPORT_PERIOD 10000000  //time in us between follower reports
+#define MAX_LOG 200000  //actions read from one log by compare
+
+//		global variables
+static double drift;  //local clock rate error (0.0001 is 100 ppm fast)
+static int64_t offset;  //local clock offset in us
+static FILE *log_file;  //actions played, if logging
+static int link_down;  //1 once the other end of the link has gone
+
+static const pattern_event test_pattern[]= {  //about 0.4 s per loop at recorded speed
+	{ 0, 1, 1 }, { 30000, 3, 1 }, { 25000, 1, 0 }, { 60000, 5, 1 },
+	{ 40000, 3, 0 }, { 20000, 2, 1 }, { 80000, 5, 0 }, { 35000, 2, 0 },
+	{ 50000, 4, 1 }, { 45000, 4, 0 }
+};
+
+
+/*
+		Helper function that returns the host clock in us.
+*/
+static uint64_t host_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+
+/*
+		Helper function that returns this board's local clock
+		in us.
+*/
+static uint64_t local_now(void) {
+	uint64_t host= host_now();
+	return host + (int64_t) (host*drift) + offset;
+}
+
+
+/*
+		Function that logs an action instead of lighting an LED.
+		lockstep_next() is the time the action was scheduled for.
+*/
+void led_set(int num, int on) {
+	if (log_file != NULL) {
+		fprintf(log_file, "%llu %d %s\n", (unsigned long long) lockstep_next(), num, on ? "on" : "off");
+	}
+}
+
+
+/*
+		Helper function that sends one frame on stdout, for
+		lockstep_send(). A pipe is never busy, so it always
+		returns 1.
+*/
+static int send_frame(sync_type type, uint64_t time, uint32_t arg) {
+	uint8_t buf[SYNC_FRAME_SIZE];
+
+	sync_encode(buf, type, time, arg);
+	if (write(STDOUT_FILENO, buf, sizeof(buf)) != sizeof(buf)) link_down= 1;  //followers gone
+	return 1;
+}
+
+
+/*
+		Helper function that plays every action that is due.
+		Returns the time in us until the next one, at most
+		max_us.
+*/
+static uint64_t play_due(uint64_t max_us) {
+	uint64_t now;
+
+	while ((now= sync_time(local_now())) >= lockstep_next()) lockstep_step();
+
+	return (lockstep_next() - now < max_us) ? lockstep_next() - now : max_us;
+}
+
+
+/*
+		Helper function that posts the button press the leader
+		makes next: mostly speed changes that keep the scale
+		between a quarter and four times recorded speed, and
+		sometimes a reverse.
+*/
+static void press_button(unsigned int *seed) {
+	unsigned int scale;
+	int direction;
+	int r= rand_r(seed) % 10;
+
+	get_play_state(&scale, &direction);
+	if (r < 2) event_post(EVENT_REVERSE, (uint32_t) local_now());
+	else if (scale > 4*PATTERN_SCALE_ONE || (r < 6 && scale > PATTERN_SCALE_ONE/4)) {
+		event_post(EVENT_SPEED_UP, (uint32_t) local_now());
+	}
+	else event_post(EVENT_SLOW_DOWN, (uint32_t) local_now());
+}
+
+
+/*
+		Function for the leader: plays the test pattern, sends
+		its frames and presses a button about once a second,
+		until seconds have passed (0 means forever).
+*/
+static int lead(unsigned int seconds) {
+	uint64_t end= host_now() + (uint64_t) seconds*1000000;
+	uint64_t next_press= host_now() + 500000;  //time of next button press
+	unsigned int seed= 1;
+
+	sync_reset(0);  //never locked: disciplined time is local time
+	lockstep_begin(1, local_now(), play_step, play_restart);
+
+	while (!link_down && (seconds == 0 || host_now() < end)) {
+		if (host_now() >= next_press) {
+			press_button(&seed);
+			next_press+= 300000 + rand_r(&seed) % 1400000;
+		}
+		lockstep_edits(local_now(), 0);
+		lockstep_send(local_now(), send_frame);
+
+		struct timespec ts= { 0, (long) play_due(1000)*1000 };
+		nanosleep(&ts, NULL);
+	}
+
+	return 0;
+}
+
+
+/*
+		Function for a follower: applies every frame received,
+		plays in step with the leader and reports how far its
+		disciplined clock is from the leader's. Runs until the
+		leader closes the link.
+*/
+static int follow(void) {
+	uint8_t buf[64];
+	sync_frame frame;
+	struct pollfd in= { STDIN_FILENO, POLLIN, 0 };
+	uint64_t next_report= host_now() + REPORT_PERIOD;
+	uint64_t start= host_now();
+	int64_t max_error= 0;  //worst error since last report in us
+	int64_t worst= 0;  //worst error after first report in us
+	int frames= 0;
+
+	sync_reset(0);  //pipes add no fixed latency
+	lockstep_begin(0, local_now(), play_step, play_restart);
+	while (1) {
+		int timeout= (play_due(1000) == 1000) ? 1 : 0;  //wait for a frame unless an action is due sooner
+
+		if (poll(&in, 1, timeout) > 0) {
+			ssize_t n= read(STDIN_FILENO, buf, sizeof(buf));
+			uint64_t arrival= local_now();  //timestamp like the UART interrupt
+			if (n <= 0) break;  //leader finished
+			for (ssize_t i= 0; i<n; i++) {
+				if (sync_parse(buf[i], &frame)) {
+					lockstep_receive(&frame, arrival);
+					frames+= frame.type == SYNC_CLOCK;
+				}
+			}
+		}
+
+		if (sync_locked()) {
+			int64_t error= (int64_t) (sync_time(local_now()) - host_now());
+			if (error < 0) error= -error;
+			if (error > max_error) max_error= error;
+		}
+
+		if (host_now() >= next_report) {
+			fprintf(stderr, "follower %+.0f ppm: t=%5llus frames=%d max error=%lldus rate=%dppb\n",
+				drift*1e6, (unsigned long long) (host_now() - start)/1000000, frames,
+				(long long) max_error, (int) sync_rate());
+			if (next_report - start > REPORT_PERIOD && max_error > worst) worst= max_error;  //skip lock-in
+			max_error= 0;
+			next_report+= REPORT_PERIOD;
+		}
+	}
+
+	fprintf(stderr, "follower %+.0f ppm: worst error after lock-in %lldus\n", drift*1e6, (long long) worst);
+	return 0;
+}
+
+
+/*
+		Helper function that reads an action log into lines.
+		Returns the number of lines read, or -1 on error.
+*/
+static long read_log(const char *name, char (*lines)[48]) {
+	FILE *f= fopen(name, "r");
+	long n= 0;
+
+	if (f == NULL) {
+		perror(name);
+		return -1;
+	}
+	while (n < MAX_LOG && fgets(lines[n], sizeof(lines[n]), f) != NULL) n++;
+	fclose(f);
+
+	return n;
+}
+
+
+/*
+		Function for compare: checks that the follower's log is
+		a run of the leader's, starting where the follower
+		joined. The last leader action may be missing from the
+		follower (the link closed first) but nothing else.
+		Returns 0 if they match and 1 otherwise.
+*/
+static int compare(const char *leader_name, const char *follower_name) {
+	static char leader_lines[MAX_LOG][48], follower_lines[MAX_LOG][48];
+	long num_leader= read_log(leader_name, leader_lines);
+	long num_follower= read_log(follower_name, follower_lines);
+	long first, i;
+
+	if (num_leader < 0 || num_follower < 0) return 2;
+	if (num_follower == 0) {
+		printf("follower never played\n");
+		return 1;
+	}
+
+	for (first= 0; first<num_leader && strcmp(leader_lines[first], follower_lines[0]); first++);
+	if (first == num_leader) {
+		printf("follower's first action is not in the leader's log:\n  %s", follower_lines[0]);
+		return 1;
+	}
+
+	for (i= 0; i<num_follower; i++) {
+		if (first + i >= num_leader) {  //follower played on after the leader stopped logging
+			if (num_follower - i > 1) {
+				printf("follower played %ld actions past the leader's log\n", num_follower - i);
+				return 1;
+			}
+			break;
+		}
+		if (strcmp(leader_lines[first + i], follower_lines[i])) {
+			printf("mismatch at follower line %ld\n  leader:   %s  follower: %s", i + 1,
+				leader_lines[first + i], follower_lines[i]);
+			return 1;
+		}
+	}
+
+	printf("%ld actions match, from leader line %ld\n", i, first + 1);
+	return 0;
+}
+
+
+/*
+		Helper function that opens the action log, if one is
+		given, and loads the test pattern.
+*/
+static int setup(const char *name) {
+	if (name != NULL && (log_file= fopen(name, "w")) == NULL) {
+		perror(name);
+		return 0;
+	}
+	load_pattern(test_pattern, sizeof(test_pattern)/sizeof(test_pattern[0]));
+	return 1;
+}
+
+
+int main(int argc, char **argv) {
+	int status;
+
+	if (argc >= 2 && argc <= 4 && !strcmp(argv[1], "leader")) {
+		if (!setup(argc > 3 ? argv[3] : NULL)) return 2;
+		status= lead(argc > 2 ? (unsigned int) atoi(argv[2]) : 0);
+	}
+	else if ((argc == 4 || argc == 5) && !strcmp(argv[1], "follower")) {
+		drift= atof(argv[2])/1e6;
+		offset= atoll(argv[3]);
+		if (!setup(argc > 4 ? argv[4] : NULL)) return 2;
+		status= follow();
+	}
+	else if (argc == 4 && !strcmp(argv[1], "compare")) return compare(argv[2], argv[3]);
+	else {
+		fprintf(stderr, "usage: %s leader [seconds [log]]\n"
+			"       %s follower <drift_ppm> <offset_us> [log]\n"
+			"       %s compare <leader_log> <follower_log>\n", argv[0], argv[0], argv[0]);
+		return 2;
+	}
+
+	if (log_file != NULL) fclose(log_file);
+	return status;
+}
@@ -0,0 +1,164 @@
+/*		This file contains a host stand-in for audio reactive
+			mode. It feeds a WAV file through the same signal
+			processing the board runs (audio.c), one 1 ms frame at
+			a time, prints every LED change as "time_us led on|off"
+			(or compares against a golden timeline like sim.c) and
+			reports how long each frame took to process. Those
+			times are for the host CPU: they are only a rough guide
+			to the board's 1 ms budget, which has not been measured
+			in cycles on the board.
+
+			Build on the host (not part of the board project):
+				cc -std=c99 -O2 -I.. -o wav_sim wav_sim.c ../audio.c -lm
+
+			Usage:
+				wav_sim <in.wav> [golden]
+
+			The WAV file must be 16-bit PCM; stereo is mixed down
+			to mono. Any sample rate that is a multiple of 1000 Hz
+			works, but the board samples at MIC_RATE.
+
+			beat.wav is a 2 s fixture at MIC_RATE: a decaying tone
+			burst every 250 ms stepping through 100, 300, 800, 2000
+			and 3000 Hz (one per band), a 60 Hz kick every second
+			and light noise. check.sh compares it against
+			beat.golden, where every LED must light.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "audio.h"
+
+#define MAX_FRAME 192  //samples per frame at 192 kHz
+
+static const char *names[AUDIO_BANDS]= {"white", "yellow", "red", "blue", "green"};
+
+
+/*
+		Helper function that reads a little endian number of n
+		bytes.
+*/
+static unsigned int read_le(const uint8_t *p, int n) {
+	unsigned int value= 0;
+	for (int i= n - 1; i>=0; i--) value= (value << 8) | p[i];
+	return value;
+}
+
+
+/*
+		Helper function that returns the host clock in ns.
+*/
+static uint64_t host_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+
+int main(int argc, char **argv) {
+	FILE *in;
+	FILE *golden= NULL;  //golden timeline or NULL to print
+	uint8_t header[12];
+	uint8_t chunk[8];
+	uint8_t fmt[16];
+	unsigned int channels= 0, rate= 0, bits= 0;
+	unsigned int data_len= 0;
+	int16_t frame[MAX_FRAME];
+	uint8_t leds[AUDIO_BANDS];
+	uint8_t lit[AUDIO_BANDS]= { 0 };  //LED state last frame
+	uint8_t level;
+	long frames= 0, lines= 0;
+	uint64_t total_ns= 0, worst_ns= 0;
+	int mismatch= 0;
+
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "usage: %s <in.wav> [golden]\n", argv[0]);
+		return 2;
+	}
+	if ((in= fopen(argv[1], "rb")) == NULL) {
+		perror(argv[1]);
+		return 2;
+	}
+	if (argc == 3 && (golden= fopen(argv[2], "r")) == NULL) {
+		perror(argv[2]);
+		return 2;
+	}
+
+	if (fread(header, 1, 12, in) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) {
+		fprintf(stderr, "not a WAV file\n");
+		return 2;
+	}
+	while (fread(chunk, 1, 8, in) == 8) {  //find format and data chunks
+		unsigned int len= read_le(chunk + 4, 4);
+		if (!memcmp(chunk, "fmt ", 4) && len >= 16) {
+			if (fread(fmt, 1, 16, in) != 16) break;
+			if (read_le(fmt, 2) != 1) break;  //not PCM
+			channels= read_le(fmt + 2, 2);
+			rate= read_le(fmt + 4, 4);
+			bits= read_le(fmt + 14, 2);
+			fseek(in, (len - 16) + (len & 1), SEEK_CUR);
+		}
+		else if (!memcmp(chunk, "data", 4)) {
+			data_len= len;
+			break;
+		}
+		else fseek(in, len + (len & 1), SEEK_CUR);  //chunks are word aligned
+	}
+	if (bits != 16 || channels < 1 || channels > 2 || rate % AUDIO_FRAME_RATE || rate/AUDIO_FRAME_RATE > MAX_FRAME || !data_len) {
+		fprintf(stderr, "need 16-bit PCM, mono or stereo, rate a multiple of 1000 Hz\n");
+		return 2;
+	}
+
+	int count= rate/AUDIO_FRAME_RATE;  //samples per frame
+	int16_t raw[2*MAX_FRAME];
+	audio_init(rate);
+
+	while (data_len >= count*channels*2 && fread(raw, 2*channels, count, in) == (size_t) count) {
+		data_len-= count*channels*2;
+		for (int n= 0; n<count; n++) {  //mix down to mono
+			frame[n]= (channels == 1) ? raw[n] : (int16_t) ((raw[2*n] + raw[2*n + 1])/2);
+		}
+
+		uint64_t start= host_ns();
+		audio_frame(frame, count, leds, &level);
+		uint64_t took= host_ns() - start;
+		total_ns+= took;
+		if (took > worst_ns) worst_ns= took;
+
+		for (int i= 0; i<AUDIO_BANDS; i++) {  //report changes
+			char line[64], expected[64];
+			if (leds[i] == lit[i]) continue;
+			lit[i]= leds[i];
+			snprintf(line, sizeof(line), "%ld %s %s\n", frames*1000, names[i], leds[i] ? "on" : "off");
+			lines++;
+			if (golden == NULL) fputs(line, stdout);
+			else if (!mismatch) {
+				if (fgets(expected, sizeof(expected), golden) == NULL) strcpy(expected, "<end of golden>\n");
+				if (strcmp(line, expected)) {
+					printf("mismatch at line %ld\n  expected: %s  got:      %s", lines, expected, line);
+					mismatch= 1;
+				}
+			}
+		}
+		frames++;
+	}
+	fclose(in);
+
+	if (golden != NULL) {
+		char extra[64];
+		if (!mismatch && fgets(extra, sizeof(extra), golden) != NULL) {
+			printf("mismatch at line %ld\n  expected: %s  got:      <end of output>\n", lines + 1, extra);
+			mismatch= 1;
+		}
+		if (!mismatch) printf("%ld lines match\n", lines);
+		fclose(golden);
+	}
+
+	fprintf(stderr, "%ld frames at %u Hz: %.0f ns per frame average, %llu ns worst on this host (board budget 1000000 ns, host estimate only)\n",
+		frames, rate, frames ? (double) total_ns/frames : 0.0, (unsigned long long) worst_ns);
+	return mismatch;
+}
@@ -0,0 +1,211 @@
+/*		This file contains playback of a pattern streamed from
+			external storage, for patterns too long to hold in RAM.
+			The pattern is stored as raw records (tools/midi2pattern
+			-f raw) and ends at the first record whose LED number is
+			not 1 to 5, so the 0xFF bytes of erased flash end it
+			without a length header. Only two blocks are ever held:
+			one is played while the next is read into the other by
+			storage_read(), which returns at once and finishes in
+			the background (storage_busy() tells when). A block that
+			is not ready when playback reaches it is a stall and is
+			counted. A pattern that fits in one block is read once
+			and then loops from RAM.
+
+			Like sequence.c, this file touches no hardware, so the
+			same code runs on the board (flash.c) and in the
+			simulator (sim/stream_sim.c).
+*/
+
+#include "stream.h"
+
+//		global variables
+static uint8_t window[2][STREAM_BLOCK];  //block being played and block being read
+static int cur;  //half of window being played
+static unsigned int pos;  //next record in window[cur]
+static uint32_t base;  //storage address of the pattern
+static uint32_t block;  //block number in window[cur]
+static uint32_t fetching;  //block number being read into window[!cur]
+static uint32_t end_block;  //last block of the pattern once known
+static unsigned long stalls;  //blocks that were not ready in time
+static pattern_event current;  //action to process next
+static int looped;  //1 once next_event() passes the end of the pattern
+static int inspected;  //1 once the block read into window[!cur] has been looked at
+
+
+/*
+		Helper function that returns 1 if rec is an event and 0
+		if it marks the end of the pattern.
+*/
+static int valid(const uint8_t *rec) {
+	return rec[4] >= 1 && rec[4] <= 5;
+}
+
+
+/*
+		Helper function that looks for the end of the pattern in
+		the block just made current, so the block after it is
+		prefetched from the start of the pattern.
+*/
+static void find_end(void) {
+	for (unsigned int i= 0; i<STREAM_RECORDS; i++) {
+		if (!valid(&window[cur][i*PATTERN_RECORD_SIZE])) {
+			end_block= block;
+			return;
+		}
+	}
+}
+
+
+/*
+		Helper function that returns the block played after
+		block b.
+*/
+static uint32_t next_block(uint32_t b) {
+	return (b >= end_block) ? 0 : b + 1;
+}
+
+
+/*
+		Helper function that starts reading the block after the
+		one being played into the other half of window. Nothing
+		is read once the whole pattern is known to fit in block
+		0: it stays in window[cur] and loops from there.
+*/
+static void prefetch(void) {
+	fetching= next_block(block);
+	inspected= (end_block == 0);
+	if (end_block == 0) return;  //block 0 stays resident
+	storage_read(base + fetching*STREAM_BLOCK, window[!cur], STREAM_BLOCK);
+}
+
+
+/*
+		Helper function that looks at a prefetched block as soon
+		as it has arrived, without waiting for it. If it starts
+		with the end of the pattern, the block being played is
+		the last one, so the start of the pattern is read in its
+		place while there is still a whole block to play. A
+		pattern that exactly fills its last block then loops
+		without a stall.
+*/
+static void inspect(void) {
+	if (inspected || storage_busy()) return;
+	inspected= 1;
+
+	if (fetching == block + 1 && !valid(window[!cur])) {  //end of pattern
+		end_block= block;
+		prefetch();
+	}
+}
+
+
+/*
+		Helper function that moves playback to the next block,
+		waiting for it if the prefetch has not finished, and
+		starts reading the one after.
+*/
+static void advance(void) {
+	int stalled= 0;
+
+	if (end_block == 0) {  //whole pattern in window[cur]
+		pos= 0;
+		return;
+	}
+
+	if (storage_busy()) {
+		stalled= 1;
+		while (storage_busy());  //wait for prefetch
+	}
+	inspect();  //may read the start of the pattern instead
+	if (storage_busy()) {
+		stalled= 1;
+		while (storage_busy());
+	}
+	stalls+= stalled;
+	if (end_block == 0) {  //block 0 turned out to hold it all
+		pos= 0;
+		return;
+	}
+
+	cur= !cur;
+	block= fetching;
+	pos= 0;
+	find_end();
+	prefetch();
+}
+
+
+/*
+		Helper function that reads the next event into current,
+		moving to the next block or back to the start as needed.
+*/
+static void next_event(void) {
+	const uint8_t *rec;
+
+	inspect();
+	while (1) {
+		if (pos == STREAM_RECORDS) advance();
+		rec= &window[cur][pos*PATTERN_RECORD_SIZE];
+		if (valid(rec)) break;
+		pos= STREAM_RECORDS;  //end of pattern: loop
+		looped= 1;
+	}
+
+	current.delay= (uint32_t) rec[0] | (uint32_t) rec[1] << 8 | (uint32_t) rec[2] << 16 | (uint32_t) rec[3] << 24;
+	current.num= rec[4];
+	current.action= rec[5];
+	pos++;
+}
+
+
+/*
+		Function that starts streaming the pattern stored at
+		address. Waits for the first block and starts reading
+		the second. Returns 1 if successful and 0 if the pattern
+		is empty.
+*/
+int stream_open(uint32_t address) {
+	base= address;
+	cur= 0;
+	pos= 0;
+	block= 0;
+	end_block= UINT32_MAX;  //not found yet
+	stalls= 0;
+
+	while (storage_busy());  //finish any earlier read
+	storage_read(base, window[0], STREAM_BLOCK);
+	while (storage_busy());
+	if (!valid(window[0])) return 0;
+
+	find_end();
+	prefetch();
+	next_event();  //first action
+	return 1;
+}
+
+
+/*
+		Function that processes the current action of the
+		stream and moves to the next one, like play_step().
+		Stores the time in us to wait before the next action in
+		wait. Returns 1 if the next action starts a new loop of
+		the pattern and 0 otherwise.
+*/
+int stream_step(unsigned int *wait) {
+	led_set(current.num, current.action);  //choose action
+
+	looped= 0;
+	next_event();
+	*wait= current.delay;  //delay belongs to the action it precedes
+
+	return looped;
+}
+
+
+/*
+		Function that returns the number of stalls since
+		stream_open().
+*/
+unsigned long stream_stalls(void) {
+	return stalls;
+}
@@ -0,0 +1,17 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <stdint.h>
+#include "sequence.h"
+
+#define STREAM_RECORDS 85  //records per block
+#define STREAM_BLOCK (STREAM_RECORDS*PATTERN_RECORD_SIZE)  //bytes per block (510)
+
+void storage_read(uint32_t address, uint8_t *buf, unsigned int len);  //provided by the firmware or the simulator
+int storage_busy(void);
+
+int stream_open(uint32_t address);
+int stream_step(unsigned int *wait);
+unsigned long stream_stalls(void);
+
+#endif
@@ -0,0 +1,129 @@
+/*		This file contains the hand-over of patterns from the
+			code that builds them (recording, loading, speed and
+			reverse edits) to playback. A pattern is a small
+			descriptor pointing at an array of events; neither is
+			changed once published, so playback never sees a
+			half-built pattern. Three descriptors rotate between
+			the builder (back), playback (front) and a shared slot
+			in between (middle). Publishing and taking a pattern are
+			each one atomic swap of the middle index, so no
+			interrupts are masked and the cost does not depend on
+			pattern length.
+
+			Edits keep the event array, so playback switches to
+			them at its next action. A new event array (restart)
+			is only taken at the start of a loop. Only one context
+			may build patterns and only one may play them.
+*/
+
+#include <stddef.h>
+#include "swap.h"
+
+#if defined(__arm__) || defined(__ARMCC_VERSION)
+#include <MK64F12.h>
+#define MEMORY_BARRIER()	__DMB()
+#else  //host build
+#define MEMORY_BARRIER()	__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+#define SWAP_INDEX 3u  //bits of middle holding a descriptor index
+#define SWAP_FRESH (1u << 2)  //middle holds a pattern playback has not taken
+#define SWAP_RESTART (1u << 3)  //...that must wait for the start of a loop
+
+static pattern buffers[3];  //descriptors- all start empty
+static volatile uint32_t middle= 1;  //index of shared descriptor and flags
+static uint32_t back= 2;  //descriptor being built- builder only
+static uint32_t front= 0;  //descriptor being played- playback only
+static pattern latest= {NULL, 0, PATTERN_SCALE_ONE, 1};  //newest published pattern- builder only
+
+
+#if defined(__arm__) || defined(__ARMCC_VERSION)
+/*
+		Helper function that replaces middle with desired if it
+		still holds expected, using LDREX/STREX. Returns 1 if
+		successful and 0 if middle changed (or an interrupt
+		broke the reservation) and the caller must retry.
+*/
+static int compare_swap(uint32_t expected, uint32_t desired) {
+	if (__LDREXW(&middle) != expected) {
+		__CLREX();
+		return 0;
+	}
+	return !__STREXW(desired, &middle);  //0 means store succeeded
+}
+#else
+/*
+		Host version of compare_swap() for simulation, where
+		threads stand in for interrupt handlers.
+*/
+static int compare_swap(uint32_t expected, uint32_t desired) {
+	return __atomic_compare_exchange_n(&middle, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+#endif
+
+
+/*
+		Function that returns the builder's spare descriptor
+		holding a copy of the newest pattern, ready to be
+		changed and published. Only the building context may
+		call this.
+*/
+pattern *pattern_edit(void) {
+	buffers[back]= latest;
+	return &buffers[back];
+}
+
+
+/*
+		Function that publishes the descriptor returned by
+		pattern_edit(). Set restart if it points at a different
+		event array, so playback only takes it at the start of a
+		loop. A restart not yet taken carries over to any edit
+		published after it. Only the building context may call
+		this.
+*/
+void pattern_publish(int restart) {
+	uint32_t old;
+	uint32_t flags= SWAP_FRESH | (restart ? SWAP_RESTART : 0);
+
+	latest= buffers[back];
+	MEMORY_BARRIER();  //descriptor complete before it is shared
+
+	do {
+		old= middle;
+		if (old & SWAP_FRESH) flags|= old & SWAP_RESTART;  //replacing an untaken restart
+	} while (!compare_swap(old, back | flags));
+
+	back= old & SWAP_INDEX;  //build in whatever was shared before
+}
+
+
+/*
+		Function that returns 1 if playback may still read
+		events and 0 once it is safe to reuse or free them. Only
+		the building context may call this.
+*/
+int pattern_busy(const pattern_event *events) {
+	if (events == latest.events) return 1;
+	return (middle & SWAP_FRESH) != 0;  //playback may still be on an older pattern
+}
+
+
+/*
+		Function that returns the pattern to play next, taking
+		a newer one if it has been published. at_start is 1 if
+		playback is at the start of a loop. Only the playing
+		context may call this.
+*/
+const pattern *pattern_take(int at_start) {
+	uint32_t old;
+
+	do {
+		old= middle;
+		if (!(old & SWAP_FRESH) || ((old & SWAP_RESTART) && !at_start)) return &buffers[front];  //keep playing
+	} while (!compare_swap(old, front));
+
+	MEMORY_BARRIER();  //read descriptor only after taking it
+	front= old & SWAP_INDEX;
+	return &buffers[front];
+}
@@ -0,0 +1,12 @@
+#ifndef __SWAP_H__
+#define __SWAP_H__
+
+#include <stdint.h>
+#include "sequence.h"
+
+pattern *pattern_edit(void);
+void pattern_publish(int restart);
+int pattern_busy(const pattern_event *events);
+const pattern *pattern_take(int at_start);
+
+#endif
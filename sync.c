@@ -0,0 +1,179 @@
+/*		This file contains the clock synchronization protocol
+			used to play patterns in lockstep on several boards.
+			One board (the leader) sends timestamped frames over
+			the serial link; every other board (a follower)
+			estimates the offset and drift of its own clock
+			against the leader's and slews a disciplined clock
+			toward it. Only an error over STEP_LIMIT (on the first
+			frame, or after frames were lost) is stepped, which
+			may move the clock backwards. Like sequence.c it
+			touches no hardware: the caller passes in its local
+			time in us, so the same code runs on the board
+			(link.c) and on a PC (sim/sync_sim.c).
+
+			Frame layout (SYNC_FRAME_SIZE bytes):
+				0xA5 0x5A type time[8, little endian] arg[4, little endian] checksum
+*/
+
+#include "sync.h"
+
+#define SYNC_MAGIC0 0xA5
+#define SYNC_MAGIC1 0x5A
+#define STEP_LIMIT 10000  //errors above this many us are stepped, not slewed
+#define RATE_LIMIT 500000  //maximum rate adjustment in ppb (500 ppm)
+#define PPB 1000000000LL  //parts per billion
+
+//		global variables
+static unsigned int latency_us;  //time in us from leader timestamp to local timestamp
+static int locked;  //1 once the first frame has been applied
+static uint64_t base_local;  //local time of last update
+static uint64_t base_sync;  //disciplined time at base_local
+static int32_t freq_ppb;  //estimated drift of the leader relative to us
+static int32_t rate_ppb;  //drift plus phase correction currently applied
+
+static uint8_t rx_buf[SYNC_FRAME_SIZE];  //frame being received
+static int rx_len;  //number of bytes received so far
+
+
+/*
+		Helper function that computes the checksum of a frame.
+*/
+static uint8_t checksum(const uint8_t *buf) {
+	uint8_t sum= 0;
+	for (int i= 2; i<SYNC_FRAME_SIZE - 1; i++) sum+= buf[i];
+	return ~sum;
+}
+
+
+/*
+		Function that writes a frame into buf. Returns the
+		number of bytes written.
+*/
+int sync_encode(uint8_t *buf, sync_type type, uint64_t time, uint32_t arg) {
+	buf[0]= SYNC_MAGIC0;
+	buf[1]= SYNC_MAGIC1;
+	buf[2]= (uint8_t) type;
+	for (int i= 0; i<8; i++) buf[3 + i]= (uint8_t) (time >> (8*i));
+	for (int i= 0; i<4; i++) buf[11 + i]= (uint8_t) (arg >> (8*i));
+	buf[SYNC_FRAME_SIZE - 1]= checksum(buf);
+
+	return SYNC_FRAME_SIZE;
+}
+
+
+/*
+		Function that feeds one received byte to the frame
+		parser. Resynchronizes on the magic bytes after noise.
+		Returns 1 and fills frame when a valid frame completes
+		and 0 otherwise. Only one context may call this.
+*/
+int sync_parse(uint8_t byte, sync_frame *frame) {
+	if (rx_len == 0 && byte != SYNC_MAGIC0) return 0;  //wait for start of frame
+	if (rx_len == 1 && byte != SYNC_MAGIC1) {
+		rx_len= (byte == SYNC_MAGIC0) ? 1 : 0;  //may be a new start of frame
+		return 0;
+	}
+
+	rx_buf[rx_len++]= byte;
+	if (rx_len < SYNC_FRAME_SIZE) return 0;  //frame not complete
+	rx_len= 0;
+
+	if (checksum(rx_buf) != rx_buf[SYNC_FRAME_SIZE - 1]) return 0;  //corrupted frame
+	if (rx_buf[2] < SYNC_CLOCK || rx_buf[2] > SYNC_EDIT) return 0;  //unknown type
+
+	frame->type= rx_buf[2];
+	frame->time= 0;
+	for (int i= 7; i>=0; i--) frame->time= (frame->time << 8) | rx_buf[3 + i];
+	frame->arg= 0;
+	for (int i= 3; i>=0; i--) frame->arg= (frame->arg << 8) | rx_buf[11 + i];
+
+	return 1;
+}
+
+
+/*
+		Function that forgets all clock estimates. latency is
+		the fixed time in us between the leader taking its
+		timestamp and the follower taking its own (for a UART
+		this is the time to send one frame).
+*/
+void sync_reset(unsigned int latency) {
+	latency_us= latency;
+	locked= 0;
+	freq_ppb= 0;
+	rate_ppb= 0;
+	rx_len= 0;
+}
+
+
+/*
+		Helper function that limits a rate to +-RATE_LIMIT.
+*/
+static int32_t clamp(int64_t ppb) {
+	if (ppb > RATE_LIMIT) return RATE_LIMIT;
+	if (ppb < -RATE_LIMIT) return -RATE_LIMIT;
+	return (int32_t) ppb;
+}
+
+
+/*
+		Function that applies one SYNC_CLOCK sample: the leader's
+		clock read leader_time when it sent a frame that arrived
+		at local time local. The first sample, or one more than
+		STEP_LIMIT off in either direction, sets the clock
+		directly, so it may jump backwards. Otherwise the error
+		is removed by slewing: part of it goes into the drift
+		estimate and part into a temporary rate correction, so
+		the disciplined clock stays continuous and monotonic.
+*/
+void sync_update(uint64_t leader_time, uint64_t local) {
+	uint64_t target= leader_time + latency_us;  //leader's clock at local
+	uint64_t now= sync_time(local);  //our disciplined clock at local
+	int64_t error= (int64_t) (target - now);  //us we are behind the leader
+	int64_t interval= (int64_t) (local - base_local);  //us since last update
+
+	if (!locked || interval <= 0 || error > STEP_LIMIT || error < -STEP_LIMIT) {
+		base_local= local;  //step to leader's clock
+		base_sync= target;
+		rate_ppb= freq_ppb;
+		locked= 1;
+		return;
+	}
+
+	int64_t ppb= error*PPB/interval;  //rate that would remove the error over one interval
+	freq_ppb= clamp(freq_ppb + ppb/8);  //slowly learn drift
+	rate_ppb= clamp(freq_ppb + ppb/2);  //remove half the error by next update
+
+	base_local= local;  //rebase so the clock doesn't jump
+	base_sync= now;
+}
+
+
+/*
+		Function that converts a local time in us into the
+		disciplined (leader's) time in us. Returns local time
+		unchanged until the first frame has been applied.
+*/
+uint64_t sync_time(uint64_t local) {
+	if (!locked) return local;
+
+	int64_t elapsed= (int64_t) (local - base_local);
+	return base_sync + elapsed + elapsed*rate_ppb/PPB;
+}
+
+
+/*
+		Function that returns 1 once the clock follows a leader.
+*/
+int sync_locked(void) {
+	return locked;
+}
+
+
+/*
+		Function that returns the current rate correction in
+		ppb (positive means our clock runs slow).
+*/
+int32_t sync_rate(void) {
+	return rate_ppb;
+}
@@ -0,0 +1,30 @@
+#ifndef __SYNC_H__
+#define __SYNC_H__
+
+#include <stdint.h>
+
+#define SYNC_FRAME_SIZE 16  //bytes in one frame on the wire
+#define SYNC_PERIOD 100000  //time in us between leader SYNC frames
+
+typedef enum {  //frame types sent by the leader
+	SYNC_CLOCK= 1,  //time is the leader's clock when the frame was sent
+	SYNC_START= 2,  //time is when the leader's pattern (re)starts, arg its state then
+	SYNC_EDIT= 3  //arg is the state the pattern changes to at the first action at or after time
+} sync_type;
+
+typedef struct {  //one decoded frame
+	uint8_t type;  //sync_type
+	uint64_t time;  //time in us on the leader's clock
+	uint32_t arg;  //depends on type, 0 if unused
+} sync_frame;
+
+int sync_encode(uint8_t *buf, sync_type type, uint64_t time, uint32_t arg);
+int sync_parse(uint8_t byte, sync_frame *frame);
+
+void sync_reset(unsigned int latency);
+void sync_update(uint64_t leader_time, uint64_t local);
+uint64_t sync_time(uint64_t local);
+int sync_locked(void);
+int32_t sync_rate(void);
+
+#endif
@@ -0,0 +1,185 @@
+/*		This file contains the single timebase every other file
+			uses for timing. PIT1 runs free from the bus clock and
+			is turned into microseconds here, so delays and
+			schedules are written in real time units instead of
+			hand-calibrated loop counts. Clock_SetProfile() switches
+			the MCG between profiles at run time; the microsecond
+			clock carries on across the switch and every function
+			registered with Clock_OnChange() is called to reprogram
+			its timer or baud rate for the new bus clock.
+*/
+
+#include <MK64F12.h>
+#include "timebase.h"
+
+//		global variables
+static clock_profile profile= CLOCK_RESET;  //current profile
+static unsigned int bus_clock;  //bus clock in Hz
+static uint64_t base_us;  //us counted before last profile switch
+static uint64_t cycles;  //PIT1 cycles counted since last profile switch
+static uint32_t last_count;  //PIT1 count at last Clock_Now()
+static void (*hooks[CLOCK_MAX_HOOKS])(void);  //called after every switch
+static int num_hooks;
+
+
+/*
+		Helper function that works out the bus clock from the
+		core clock and the bus divider.
+*/
+static void update_clocks(void) {
+	SystemCoreClockUpdate();
+	bus_clock= SystemCoreClock/(((SIM->CLKDIV1 >> 24) & 0xF) + 1);
+}
+
+
+/*
+		Helper function that converts bus cycles to us without
+		overflowing for long uptimes.
+*/
+static uint64_t to_us(uint64_t n) {
+	return (n/bus_clock)*1000000 + (n%bus_clock)*1000000/bus_clock;
+}
+
+
+/*
+		Function that starts PIT1 as a free-running counter.
+*/
+void Clock_Init(void) {
+	update_clocks();
+	SIM->SCGC6 |= SIM_SCGC6_PIT_MASK;  // enable clock to PIT module
+	PIT->MCR = (0 << 1);  // enable clock to PIT timers
+	PIT->CHANNEL[1].LDVAL = 0xFFFFFFFF;  //count full range, no interrupts
+	PIT->CHANNEL[1].TCTRL = 0x1;  //start timer
+	last_count= Clock_Count();
+}
+
+
+/*
+		Function that returns the bus clock in Hz for the
+		current profile.
+*/
+unsigned int Clock_Bus(void) {
+	return bus_clock;
+}
+
+
+/*
+		Function that registers hook to be called after every
+		profile switch. Returns 1 if successful and 0 if there
+		are too many hooks.
+*/
+int Clock_OnChange(void (*hook)(void)) {
+	for (int i= 0; i<num_hooks; i++) {
+		if (hooks[i] == hook) return 1;  //already registered
+	}
+	if (num_hooks == CLOCK_MAX_HOOKS) return 0;
+	hooks[num_hooks++]= hook;
+	return 1;
+}
+
+
+/*
+		Function that returns local time in us since Clock_Init().
+		Must be called at least once every 2^32 bus cycles (71
+		seconds at the 60 MHz bus of CLOCK_FAST, longer at the
+		other profiles) and only from the main loop.
+*/
+uint64_t Clock_Now(void) {
+	uint32_t count= Clock_Count();
+
+	cycles+= count - last_count;  //unsigned difference handles wrap
+	last_count= count;
+
+	return base_us + to_us(cycles);
+}
+
+
+/*
+		Function that converts a Clock_Count() value taken in
+		the last 2^32 cycles (e.g. by an interrupt handler) into
+		local time in us. Only the main loop may call this.
+*/
+uint64_t Clock_At(uint32_t count) {
+	uint32_t ago;  //cycles since count
+
+	Clock_Now();  //bring cycles up to date
+	ago= last_count - count;
+	if (ago > cycles) return base_us;  //taken before last profile switch
+	return base_us + to_us(cycles - ago);
+}
+
+
+/*
+		Function that busy-waits for us microseconds. Safe in
+		any context, including interrupt handlers.
+*/
+void Clock_Delay(unsigned int us) {
+	uint32_t start= Clock_Count();
+	uint32_t wait= (uint32_t) ((uint64_t) us*bus_clock/1000000);
+
+	while (Clock_Count() - start < wait);  //do nothing
+}
+
+
+/*
+		Helper function that moves from the current profile to
+		FLL engaged internal (FEI), the reset mode, with all
+		dividers at 1.
+*/
+static void to_fei(void) {
+	if (profile == CLOCK_FAST) {  //PEE -> PBE -> FBE -> FEI
+		MCG->C1 = (2 << 6 | 5 << 3);  //external clock straight to system
+		while (((MCG->S >> 2) & 3) != 2);
+		MCG->C6 = 0;  //PLL off
+		while (MCG->S & (1 << 5));
+	}
+	else if (profile == CLOCK_LOW) {  //BLPI -> FBI -> FEI
+		MCG->C2 &= ~(1 << 1);  //FLL back on
+	}
+
+	MCG->C1 = (1 << 2);  //FLL from slow internal reference
+	while (!(MCG->S & (1 << 4)) || ((MCG->S >> 2) & 3) != 0);
+	SIM->CLKDIV1 = 0;  //core, bus, FlexBus and flash at 20.97 MHz
+	profile= CLOCK_RESET;
+}
+
+
+/*
+		Function that switches the clocks to a new profile and
+		then calls every Clock_OnChange() hook. Only the main
+		loop may call this. Dividers are raised before the clock
+		speeds up and lowered after it slows down, so flash
+		never runs above 25 MHz.
+*/
+void Clock_SetProfile(clock_profile next) {
+	if (next == profile) return;
+
+	Clock_Now();  //keep the us clock continuous across the switch
+	base_us+= to_us(cycles);
+	cycles= 0;
+
+	to_fei();
+	if (next == CLOCK_FAST) {  //FEI -> FBE -> PBE -> PEE
+		SIM->CLKDIV1 = (0 << 28 | 1 << 24 | 2 << 20 | 4 << 16);  //core 120, bus 60, FlexBus 40, flash 24 MHz
+		OSC->CR = 0;  //external clock on EXTAL0, no crystal
+		MCG->C2 = (2 << 4);  //very high frequency range
+		MCG->C1 = (2 << 6 | 5 << 3);  //external clock straight to system, FLL reference /1280
+		while ((MCG->S & (1 << 4)) || ((MCG->S >> 2) & 3) != 2);
+		MCG->C5 = 19;  //PLL reference 50 MHz / 20 = 2.5 MHz
+		MCG->C6 = (1 << 6 | 24);  //PLL on, 2.5 MHz x 48 = 120 MHz
+		while (!(MCG->S & (1 << 5)) || !(MCG->S & (1 << 6)));  //PLL selected and locked
+		MCG->C1 = (5 << 3);  //PLL to system
+		while (((MCG->S >> 2) & 3) != 3);
+	}
+	else if (next == CLOCK_LOW) {  //FEI -> FBI -> BLPI
+		MCG->SC &= ~(7 << 1);  //fast internal reference / 1
+		MCG->C2 |= (1 << 0);  //fast (4 MHz) internal reference
+		MCG->C1 = (1 << 6 | 1 << 2);  //internal reference straight to system
+		while (((MCG->S >> 2) & 3) != 1);
+		MCG->C2 |= (1 << 1);  //FLL off
+	}
+	profile= next;
+
+	update_clocks();
+	for (int i= 0; i<num_hooks; i++) hooks[i]();  //retime peripherals
+}
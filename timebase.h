@@ -0,0 +1,31 @@
+#ifndef __TIMEBASE_H__
+#define __TIMEBASE_H__
+
+#include <stdint.h>
+#include <MK64F12.h>
+
+typedef enum {  //clock profiles
+	CLOCK_LOW,  //4 MHz internal reference, FLL and PLL off: idle playback
+	CLOCK_RESET,  //20.97 MHz FLL, as after reset
+	CLOCK_FAST  //120 MHz PLL from the 50 MHz external clock: heavy work
+} clock_profile;
+
+#define CLOCK_MAX_HOOKS 8  //maximum number of Clock_OnChange() functions
+
+void Clock_Init(void);
+void Clock_SetProfile(clock_profile profile);
+int Clock_OnChange(void (*hook)(void));
+unsigned int Clock_Bus(void);
+uint64_t Clock_Now(void);
+uint64_t Clock_At(uint32_t count);
+void Clock_Delay(unsigned int us);
+
+/*
+		Function that returns the number of bus cycles PIT1 has
+		counted. Wraps every 2^32 cycles. Safe in any context.
+*/
+static inline uint32_t Clock_Count(void) {
+	return ~PIT->CHANNEL[1].CVAL;  //PIT counts down from 0xFFFFFFFF
+}
+
+#endif
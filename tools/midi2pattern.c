@@ -0,0 +1,334 @@
+/*		This file contains a host tool that compiles a Standard
+			MIDI File into an LED pattern, so light shows can be
+			synced to music instead of tapped in by hand. The
+			whole file is read into memory first (MIDI files are
+			small; only the output is written as it is made). Tracks
+			are merged in time order in a single pass over it,
+			tempo changes are applied as they are met, and
+			every note becomes an on/off event for one of the five
+			LEDs. Overlapping notes on the same LED keep it lit
+			until the last one ends.
+
+			Build on the host (not part of the board project):
+				cc -std=c99 -O2 -I.. -o midi2pattern midi2pattern.c
+
+			Usage:
+				midi2pattern [-c | -t] [-f c | raw] <in.mid> <out>
+
+			LEDs are chosen by note number modulo 5 (default), by
+			MIDI channel modulo 5 (-c) or by track index modulo 5
+			(-t). The output is either C source defining
+			baked_pattern for the firmware (-f c, default: add it to
+			the project and define BAKED_PATTERN), or raw records of
+			PATTERN_RECORD_SIZE bytes (-f raw: write them to SPI
+			flash and define STREAM_PATTERN to stream patterns too
+			long for RAM, see stream.c). The wait before the
+			first event includes the silence at the end of the song
+			so the pattern loops in time.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "sequence.h"
+
+#define MAX_TRACKS 256  //maximum number of tracks in a file
+
+enum { MAP_NOTE, MAP_CHANNEL, MAP_TRACK };  //how notes choose an LED
+enum { FORMAT_C, FORMAT_RAW };  //output format
+
+struct track {  //struct representing one track being read
+	const uint8_t *pos;  //next byte to read
+	const uint8_t *end;  //end of track data
+	uint64_t tick;  //absolute time of next event in ticks
+	uint8_t status;  //running status
+	int done;  //1 once end of track is reached
+};
+
+//		global variables
+static struct track tracks[MAX_TRACKS];  //tracks in file
+static int num_tracks;  //number of tracks in file
+static unsigned int division;  //ticks per quarter note, or SMPTE format if bit 15 is set
+static int map= MAP_NOTE;
+static int format= FORMAT_C;
+
+static uint64_t tempo_tick;  //tick of last tempo change
+static uint64_t tempo_us;  //time in us of last tempo change
+static unsigned int tempo= 500000;  //us per quarter note (120 bpm until told otherwise)
+
+static FILE *out;  //output file
+static long first_pos;  //file position of first event's delay
+static unsigned int first_delay;  //first event's delay
+static uint64_t last_us;  //time in us of last event written
+static long num_events;  //number of events written
+static int lit[6];  //notes holding each LED on, indexed by LED number
+
+
+/*
+		Helper function that prints an error and exits.
+*/
+static void fail(const char *msg) {
+	fprintf(stderr, "midi2pattern: %s\n", msg);
+	exit(1);
+}
+
+
+/*
+		Helper function that reads a big endian number of n
+		bytes.
+*/
+static unsigned int read_be(const uint8_t *p, int n) {
+	unsigned int value= 0;
+	for (int i= 0; i<n; i++) value= (value << 8) | p[i];
+	return value;
+}
+
+
+/*
+		Helper function that reads a variable length quantity
+		from a track.
+*/
+static unsigned int read_var(struct track *t) {
+	unsigned int value= 0;
+
+	for (int i= 0; i<4; i++) {
+		if (t->pos >= t->end) fail("truncated track");
+		uint8_t byte= *t->pos++;
+		value= (value << 7) | (byte & 0x7F);
+		if (!(byte & 0x80)) return value;
+	}
+	fail("bad variable length quantity");
+	return 0;
+}
+
+
+/*
+		Helper function that reads the delta time of a track's
+		next event, or marks the track done.
+*/
+static void next_event(struct track *t) {
+	if (t->pos >= t->end) t->done= 1;  //no end of track event- stop anyway
+	else t->tick+= read_var(t);
+}
+
+
+/*
+		Helper function that converts an absolute tick to us
+		using the tempo map so far.
+*/
+static uint64_t tick_us(uint64_t tick) {
+	uint64_t ticks= tick - tempo_tick;
+
+	if (division & 0x8000) {  //SMPTE: frames per second and ticks per frame
+		unsigned int fps= 256 - (division >> 8);  //stored as negative
+		unsigned int per_frame= division & 0xFF;
+		return tempo_us + ticks*1000000/(fps*per_frame);
+	}
+	return tempo_us + ticks*tempo/division;
+}
+
+
+/*
+		Helper function that writes one event at time us.
+*/
+static void write_event(int num, int action, uint64_t us) {
+	uint64_t delay= us - last_us;
+	uint8_t rec[PATTERN_RECORD_SIZE];
+
+	if (delay > 0xFFFFFFFF) fail("gap between events longer than 71 minutes");
+	if (num_events == 0) {  //remember where to patch in the loop gap
+		first_pos= ftell(out);
+		first_delay= (unsigned int) delay;
+	}
+
+	if (format == FORMAT_RAW) {
+		for (int i= 0; i<4; i++) rec[i]= (uint8_t) (delay >> (8*i));
+		rec[4]= (uint8_t) num;
+		rec[5]= (uint8_t) action;
+		fwrite(rec, 1, sizeof(rec), out);
+	}
+	else fprintf(out, "\t{ %10u, %d, %d },\n", (unsigned int) delay, num, action);
+
+	last_us= us;
+	num_events++;
+}
+
+
+/*
+		Helper function that turns a note on or off on its LED.
+*/
+static void note(int num, int on, uint64_t us) {
+	if (on) {
+		if (lit[num]++ == 0) write_event(num, 1, us);  //first note lights LED
+	}
+	else if (lit[num] > 0 && --lit[num] == 0) write_event(num, 0, us);  //last note ends
+}
+
+
+/*
+		Helper function that processes the next event of track
+		index ti. Returns the event's time in us.
+*/
+static uint64_t process(int ti) {
+	struct track *t= &tracks[ti];
+	uint64_t us= tick_us(t->tick);
+	uint8_t status;
+
+	if (t->pos >= t->end) fail("truncated track");
+	if (*t->pos & 0x80) status= *t->pos++;
+	else if (t->status) status= t->status;  //running status
+	else fail("data byte without status");
+
+	if (status == 0xFF) {  //meta event
+		if (t->pos >= t->end) fail("truncated track");
+		uint8_t type= *t->pos++;
+		unsigned int len= read_var(t);
+		if (len > (unsigned int) (t->end - t->pos)) fail("truncated meta event");
+		if (type == 0x51 && len == 3) {  //tempo change
+			tempo_us= us;
+			tempo_tick= t->tick;
+			tempo= read_be(t->pos, 3);
+			if (tempo == 0) fail("zero tempo");
+		}
+		t->pos+= len;
+		if (type == 0x2F) {  //end of track
+			t->done= 1;
+			return us;
+		}
+	}
+	else if (status == 0xF0 || status == 0xF7) {  //system exclusive
+		unsigned int len= read_var(t);
+		if (len > (unsigned int) (t->end - t->pos)) fail("truncated sysex");
+		t->pos+= len;
+		t->status= 0;  //cancels running status
+	}
+	else {  //channel message
+		int bytes= ((status & 0xF0) == 0xC0 || (status & 0xF0) == 0xD0) ? 1 : 2;
+		if (t->end - t->pos < bytes) fail("truncated event");
+		t->status= status;
+
+		if ((status & 0xF0) == 0x80 || (status & 0xF0) == 0x90) {  //note off or on
+			int key= t->pos[0];
+			int on= (status & 0xF0) == 0x90 && t->pos[1] > 0;  //velocity 0 means off
+			int num;
+			if (map == MAP_CHANNEL) num= (status & 0x0F) % 5 + 1;
+			else if (map == MAP_TRACK) num= ti % 5 + 1;
+			else num= key % 5 + 1;
+			note(num, on, us);
+		}
+		t->pos+= bytes;
+	}
+
+	next_event(t);
+	return us;
+}
+
+
+/*
+		Helper function that finds the header and tracks in the
+		file data.
+*/
+static void load(const uint8_t *data, long size) {
+	const uint8_t *p= data;
+	const uint8_t *end= data + size;
+
+	if (size < 14 || memcmp(p, "MThd", 4) || read_be(p + 4, 4) < 6) fail("not a MIDI file");
+	division= read_be(p + 12, 2);
+	if (division == 0) fail("zero division");
+	p+= 8 + read_be(p + 4, 4);
+
+	while (end - p >= 8) {  //walk chunks
+		unsigned int len= read_be(p + 4, 4);
+		if (len > (unsigned int) (end - p - 8)) fail("truncated chunk");
+		if (!memcmp(p, "MTrk", 4)) {
+			if (num_tracks == MAX_TRACKS) fail("too many tracks");
+			struct track *t= &tracks[num_tracks++];
+			t->pos= p + 8;
+			t->end= p + 8 + len;
+			next_event(t);
+		}
+		p+= 8 + len;  //skip unknown chunks
+	}
+}
+
+
+int main(int argc, char **argv) {
+	int arg;
+	FILE *in;
+	long size;
+	uint8_t *data;
+	uint64_t end_us= 0;  //time in us the song ends
+	clock_t start= clock();
+
+	for (arg= 1; arg<argc && argv[arg][0] == '-'; arg++) {
+		if (!strcmp(argv[arg], "-c")) map= MAP_CHANNEL;
+		else if (!strcmp(argv[arg], "-t")) map= MAP_TRACK;
+		else if (!strcmp(argv[arg], "-f") && arg + 1 < argc) {
+			arg++;
+			if (!strcmp(argv[arg], "c")) format= FORMAT_C;
+			else if (!strcmp(argv[arg], "raw")) format= FORMAT_RAW;
+			else fail("format must be c or raw");
+		}
+		else break;
+	}
+	if (argc - arg != 2) {
+		fprintf(stderr, "usage: %s [-c | -t] [-f c | raw] <in.mid> <out>\n", argv[0]);
+		return 2;
+	}
+
+	if ((in= fopen(argv[arg], "rb")) == NULL) fail("cannot open input");
+	fseek(in, 0, SEEK_END);
+	size= ftell(in);
+	rewind(in);
+	if ((data= malloc(size > 0 ? size : 1)) == NULL) fail("out of memory");
+	if (fread(data, 1, size, in) != (size_t) size) fail("cannot read input");
+	fclose(in);
+	load(data, size);
+
+	if ((out= fopen(argv[arg + 1], format == FORMAT_RAW ? "wb" : "w")) == NULL) fail("cannot open output");
+	if (format == FORMAT_C) {
+		fprintf(out, "/*		Generated by tools/midi2pattern from %s. */\n\n", argv[arg]);
+		fprintf(out, "#include \"sequence.h\"\n\nconst pattern_event baked_pattern[]= {\n");
+	}
+
+	while (1) {  //merge tracks: always take the earliest pending event
+		int ti= -1;
+		for (int i= 0; i<num_tracks; i++) {
+			if (!tracks[i].done && (ti < 0 || tracks[i].tick < tracks[ti].tick)) ti= i;
+		}
+		if (ti < 0) break;  //all tracks done
+		uint64_t us= process(ti);
+		if (us > end_us) end_us= us;
+	}
+
+	for (int num= 1; num<=5; num++) {  //end notes still sounding
+		if (lit[num]) {
+			lit[num]= 1;
+			note(num, 0, end_us);
+		}
+	}
+	if (num_events == 0) fail("no notes in file");
+
+	if (format == FORMAT_C) {
+		fprintf(out, "};\nconst int baked_pattern_len= %ld;\n", num_events);
+	}
+	if (end_us > last_us) {  //add the silence at the end to the wait before the first event
+		uint64_t loop= (uint64_t) first_delay + (end_us - last_us);
+		if (loop > 0xFFFFFFFF) fail("silence at end of song longer than 71 minutes");
+		fseek(out, first_pos, SEEK_SET);
+		if (format == FORMAT_RAW) {
+			uint8_t d[4];
+			for (int i= 0; i<4; i++) d[i]= (uint8_t) (loop >> (8*i));
+			fwrite(d, 1, 4, out);
+		}
+		else fprintf(out, "\t{ %10u,", (unsigned int) loop);
+	}
+	if (fclose(out)) fail("cannot write output");
+	free(data);
+
+	fprintf(stderr, "%ld events from %d tracks, %.1f s of music, converted in %.1f ms\n",
+		num_events, num_tracks, end_us/1e6, (clock() - start)*1000.0/CLOCKS_PER_SEC);
+	return 0;
+}
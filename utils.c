@@ -1,5 +1,6 @@
 #include <MK64F12.h>
 #include "utils.h"
+#include "timebase.h"
 
 /*----------------------------------------------------------------------------
   Function that initializes LEDs
@@ -19,96 +20,8 @@ void LED_Initialize(void) {
 }
 
 /*----------------------------------------------------------------------------
-  Function that toggles the red LED
+  Function that busy-waits for 0.2 s at any clock profile
  *----------------------------------------------------------------------------*/
-
-void LEDRed_Toggle (void) {
-	PTB->PTOR = 1 << 22; 	   /* Red LED Toggle */
-}
-
-/*----------------------------------------------------------------------------
-  Function that toggles the blue LED
- *----------------------------------------------------------------------------*/
-void LEDBlue_Toggle (void) {
-	PTB->PTOR = 1 << 21; 	   /* Blue LED Toggle */
-}
-
-/*----------------------------------------------------------------------------
-  Function that toggles the green LED
- *----------------------------------------------------------------------------*/
-void LEDGreen_Toggle (void) {
-	PTE->PTOR = 1 << 26; 	   /* Green LED Toggle */
-}
-
-/*----------------------------------------------------------------------------
-  Function that turns on Red LED & all the others off
- *----------------------------------------------------------------------------*/
-void LEDRed_On (void) {
-	// Save and disable interrupts (for atomic LED change)
-	uint32_t m;
-	m = __get_PRIMASK();
-	__disable_irq();
-	
-  PTB->PCOR   = 1 << 22;   /* Red LED On*/
-  PTB->PSOR   = 1 << 21;   /* Blue LED Off*/
-  PTE->PSOR   = 1 << 26;   /* Green LED Off*/
-	
-	// Restore interrupts
-	__set_PRIMASK(m);
-}
-
-/*----------------------------------------------------------------------------
-  Function that turns on Green LED & all the others off
- *----------------------------------------------------------------------------*/
-void LEDGreen_On (void) {
-	// Save and disable interrupts (for atomic LED change)
-	uint32_t m;
-	m = __get_PRIMASK();
-	__disable_irq();
-	
-  PTB->PSOR   = 1 << 21;   /* Blue LED Off*/
-  PTE->PCOR   = 1 << 26;   /* Green LED On*/
-  PTB->PSOR   = 1 << 22;   /* Red LED Off*/
-	
-	// Restore interrupts
-	__set_PRIMASK(m);
-}
-
-/*----------------------------------------------------------------------------
-  Function that turns on Blue LED & all the others off
- *----------------------------------------------------------------------------*/
-void LEDBlue_On (void) {
-	// Save and disable interrupts (for atomic LED change)
-	uint32_t m;
-	m = __get_PRIMASK();
-	__disable_irq();
-	
-  PTE->PSOR   = 1 << 26;   /* Green LED Off*/
-  PTB->PSOR   = 1 << 22;   /* Red LED Off*/
-  PTB->PCOR   = 1 << 21;   /* Blue LED On*/
-	
-	// Restore interrupts
-	__set_PRIMASK(m);
-}
-
-/*----------------------------------------------------------------------------
-  Function that turns all LEDs off
- *----------------------------------------------------------------------------*/
-void LED_Off (void) {	
-	// Save and disable interrupts (for atomic LED change)
-	uint32_t m;
-	m = __get_PRIMASK();
-	__disable_irq();
-	
-  PTB->PSOR   = 1 << 22;   /* Green LED Off*/
-  PTB->PSOR   = 1 << 21;   /* Red LED Off*/
-  PTE->PSOR   = 1 << 26;   /* Blue LED Off*/
-	
-	// Restore interrupts
-	__set_PRIMASK(m);
-}
-
 void delay(void){
-	int j;
-	for(j=0; j<1000000; j++);
+	Clock_Delay(200000);
 }
@@ -1,14 +1,77 @@
 #ifndef __UTILS_H__
 #define __UTILS_H__
 
+#include <MK64F12.h>
+
+/*----------------------------------------------------------------------------
+  Onboard RGB LED pins. The LED is active low: PCOR turns a colour on and
+  PSOR turns it off. Each write below is a single atomic store, so no
+  interrupts need to be disabled. Red and blue share port B, so LED_Off
+  and LEDGreen_On clear both with one store, but turning red or blue on
+  takes two port B stores (PSOR for the other, PCOR for itself) plus one
+  to port E. Once RGB_Init() has run, the DMA drives these pins; use
+  rgb.h instead.
+ *----------------------------------------------------------------------------*/
+#define LED_RED_PIN		22  /* PTB22 */
+#define LED_BLUE_PIN	21  /* PTB21 */
+#define LED_GREEN_PIN	26  /* PTE26 */
+
 void LED_Initialize(void);
-void LEDRed_Toggle (void);
-void LEDBlue_Toggle (void);
-void LEDGreen_Toggle (void);
-void LEDRed_On (void);
-void LEDGreen_On (void);
-void LEDBlue_On (void);
-void LED_Off (void);
 void delay (void);
 
+/*----------------------------------------------------------------------------
+  Function that toggles the red LED
+ *----------------------------------------------------------------------------*/
+static inline void LEDRed_Toggle (void) {
+	PTB->PTOR = 1 << LED_RED_PIN;                                    /* Red LED Toggle */
+}
+
+/*----------------------------------------------------------------------------
+  Function that toggles the blue LED
+ *----------------------------------------------------------------------------*/
+static inline void LEDBlue_Toggle (void) {
+	PTB->PTOR = 1 << LED_BLUE_PIN;                                   /* Blue LED Toggle */
+}
+
+/*----------------------------------------------------------------------------
+  Function that toggles the green LED
+ *----------------------------------------------------------------------------*/
+static inline void LEDGreen_Toggle (void) {
+	PTE->PTOR = 1 << LED_GREEN_PIN;                                  /* Green LED Toggle */
+}
+
+/*----------------------------------------------------------------------------
+  Function that turns on Red LED & all the others off
+ *----------------------------------------------------------------------------*/
+static inline void LEDRed_On (void) {
+	PTB->PSOR = 1 << LED_BLUE_PIN;                                   /* Blue LED Off */
+	PTE->PSOR = 1 << LED_GREEN_PIN;                                  /* Green LED Off */
+	PTB->PCOR = 1 << LED_RED_PIN;                                    /* Red LED On */
+}
+
+/*----------------------------------------------------------------------------
+  Function that turns on Green LED & all the others off
+ *----------------------------------------------------------------------------*/
+static inline void LEDGreen_On (void) {
+	PTB->PSOR = 1 << LED_RED_PIN | 1 << LED_BLUE_PIN;                /* Red & Blue LED Off */
+	PTE->PCOR = 1 << LED_GREEN_PIN;                                  /* Green LED On */
+}
+
+/*----------------------------------------------------------------------------
+  Function that turns on Blue LED & all the others off
+ *----------------------------------------------------------------------------*/
+static inline void LEDBlue_On (void) {
+	PTE->PSOR = 1 << LED_GREEN_PIN;                                  /* Green LED Off */
+	PTB->PSOR = 1 << LED_RED_PIN;                                    /* Red LED Off */
+	PTB->PCOR = 1 << LED_BLUE_PIN;                                   /* Blue LED On */
+}
+
+/*----------------------------------------------------------------------------
+  Function that turns all LEDs off
+ *----------------------------------------------------------------------------*/
+static inline void LED_Off (void) {
+	PTB->PSOR = 1 << LED_RED_PIN | 1 << LED_BLUE_PIN;                /* Red & Blue LED Off */
+	PTE->PSOR = 1 << LED_GREEN_PIN;                                  /* Green LED Off */
+}
+
 #endif
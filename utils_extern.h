@@ -1,16 +1,171 @@
 #ifndef __UTILS_EXTERN_H__
 #define __UTILS_EXTERN_H__
 
+#include <stddef.h>
+#include <MK64F12.h>
+
+/*
+		Table of external LEDs, all on port C, in LED number
+		order: 1 (white), 2 (yellow), 3 (red), 4 (blue), 5 (green),
+		with the port and pin of the button beside each one.
+		Every LED and button pin used elsewhere comes from it,
+		except the start button (PTC12), which has no LED.
+		Buttons must be on port B or C, the two ports mirror()
+		reads and the two with button interrupt handlers.
+*/
+#define EXTERN_LEDS(X) \
+	X(White,  5, C,  3) \
+	X(Yellow, 7, C,  2) \
+	X(Red,    0, B, 23) \
+	X(Blue,   8, B,  9) \
+	X(Green,  1, B, 18)
+
+#define LED_BIT(name, pin, port, button)	| (1 << pin)
+#define EXTERN_LED_MASK (0 EXTERN_LEDS(LED_BIT))  //all external LED pins
+
+/*
+		Address of the bit-band alias of bit pin in a port C
+		register. Writing 1 or 0 there sets or clears just that
+		bit in one store.
+*/
+#define PTC_BITBAND(reg, pin) \
+	(*(volatile uint32_t *) (0x42000000 + (PTC_BASE + offsetof(GPIO_Type, reg) - 0x40000000)*32 + (pin)*4))
+
+#define LED_PIN_NAME(name, pin, port, button)	name##_PIN= pin,
+enum { EXTERN_LEDS(LED_PIN_NAME) };  //White_PIN etc.
+
+#define LED_NUM_NAME(name, pin, port, button)	name##_NUM,
+enum { NO_LED, EXTERN_LEDS(LED_NUM_NAME) };  //White_NUM is 1 etc.
+
+/*
+		The functions below turn one external LED on or off.
+		PSOR and PCOR writes only affect the bits written, so a
+		single store is already atomic and no interrupts need to
+		be disabled. Each should compile to a MOV and a STR once
+		the port address is in a register; that is counted from
+		the Cortex-M4 instruction timings, not measured on the
+		board.
+*/
+
+/*
+		Function that turns on external white LED.
+*/
+static inline void White_On(void) {
+	PTC->PSOR = 1 << White_PIN;  //white LED on
+}
+
+
+/*
+		Function that turns off external white LED.
+*/
+static inline void White_Off(void) {
+	PTC->PCOR = 1 << White_PIN;  //white LED off
+}
+
+
+/*
+		Function that turns on external yellow LED.
+*/
+static inline void Yellow_On(void) {
+	PTC->PSOR = 1 << Yellow_PIN;  //yellow LED on
+}
+
+
+/*
+		Function that turns off external yellow LED.
+*/
+static inline void Yellow_Off(void) {
+	PTC->PCOR = 1 << Yellow_PIN;  //yellow LED off
+}
+
+
+/*
+		Function that turns on external red LED.
+*/
+static inline void Red_On(void) {
+	PTC->PSOR = 1 << Red_PIN;  //red LED on
+}
+
+
+/*
+		Function that turns off external red LED.
+*/
+static inline void Red_Off(void) {
+	PTC->PCOR = 1 << Red_PIN;  //red LED off
+}
+
+
+/*
+		Function that turns on external blue LED.
+*/
+static inline void Blue_On(void) {
+	PTC->PSOR = 1 << Blue_PIN;  //blue LED on
+}
+
+
+/*
+		Function that turns off external blue LED.
+*/
+static inline void Blue_Off(void) {
+	PTC->PCOR = 1 << Blue_PIN;  //blue LED off
+}
+
+
+/*
+		Function that turns on external green LED.
+*/
+static inline void Green_On(void) {
+	PTC->PSOR = 1 << Green_PIN;  //green LED on
+}
+
+
+/*
+		Function that turns off external green LED.
+*/
+static inline void Green_Off(void) {
+	PTC->PCOR = 1 << Green_PIN;  //green LED off
+}
+
+
+#define LED_PIN(name, pin, port, button)	pin,
+static const uint8_t extern_led_pin[6]= { 0, EXTERN_LEDS(LED_PIN) };  //indexed by LED number
+
+/*
+		Function that turns external LED num on (on is 1) or
+		off (on is 0) with one bit-band store and no branches
+		(about five cycles by instruction count, not measured).
+*/
+static inline void LED_Write(int num, int on) {
+	PTC_BITBAND(PDOR, extern_led_pin[num])= on;
+}
+
+#define BUTTON_PCR_CASE(name, pin, port, button)	case name##_NUM: return &PORT##port->PCR[button];
+#define BUTTON_READ_CASE(name, pin, port, button)	case name##_NUM: return (PT##port->PDIR >> button) & 1;
+
+/*
+		Function that returns the pin control register of the
+		button for LED num (1 to 5). With a constant num it
+		compiles to the register's address.
+*/
+static inline volatile uint32_t *Button_PCR(int num) {
+	switch (num) {
+		EXTERN_LEDS(BUTTON_PCR_CASE)
+	}
+	return NULL;
+}
+
+
+/*
+		Function that returns 1 if the button for LED num is
+		pressed and 0 otherwise.
+*/
+static inline int Button_Read(int num) {
+	switch (num) {
+		EXTERN_LEDS(BUTTON_READ_CASE)
+	}
+	return 0;
+}
+
 void LED_ExInit(void);
-void White_On(void);
-void White_Off(void);
-void Yellow_On(void);
-void Yellow_Off(void);
-void Red_On(void);
-void Red_Off(void);
-void Blue_On(void);
-void Blue_Off(void);
-void Green_On(void);
-void Green_Off(void);
 void Button_Init(void);
 #endif